@@ -0,0 +1,115 @@
+﻿// -*- coding: utf-8-with-signature-dos -*-
+// vim:fileencoding=utf-8:ff=dos
+//
+// A dense lookup table indexed by enumerators.
+
+#ifndef CUN_ENUM_TABLE_HPP_INCLUDED
+#define CUN_ENUM_TABLE_HPP_INCLUDED
+
+// C++ standard library
+#include <array>
+#include <cstddef>
+#include <initializer_list>
+#include <type_traits>
+#include <utility>
+
+/* ---------------------------------------------------------------------- */
+/*  */
+/* ---------------------------------------------------------------------- */
+
+namespace cun {
+
+inline namespace enum_table {
+
+/**
+ * A dense lookup table class indexed by enumerators.
+ *
+ * It provides the subset of std::map interface used for lookup (find and
+ * end), so that it can replace std::map for dense enumerations with values
+ * from 0 to N - 1. A key is present if its mapped value is not empty
+ * (a non-null function pointer, a non-empty std::function, etc.), so find
+ * is an index check and a null check.
+ */
+template <typename K, typename V, std::size_t N>
+requires std::is_enum_v<K>
+class EnumTable final {
+    static_assert(N > 0, "EnumTable: 0 size table is not allowed.");
+
+public:
+    using key_type = K;
+    using mapped_type = V;
+    using value_type = std::pair<key_type, mapped_type>;
+    using size_type = std::size_t;
+    using iterator = value_type *;
+    using const_iterator = const value_type *;
+
+private:
+    std::array<value_type, N> m_table {};
+
+    static constexpr size_type index_of(const key_type key) noexcept {
+        return static_cast<size_type>(static_cast<std::underlying_type_t<key_type>>(key));
+    }
+
+public:
+    constexpr EnumTable() = default;
+
+    constexpr EnumTable(std::initializer_list<std::pair<const key_type, mapped_type>> init) {
+        for (const auto& [key, val] : init) {
+            (void) insert_or_assign(key, val);
+        }
+    }
+
+    constexpr iterator begin() noexcept {
+        return m_table.data();
+    }
+
+    constexpr const_iterator begin() const noexcept {
+        return m_table.data();
+    }
+
+    constexpr iterator end() noexcept {
+        return m_table.data() + N;
+    }
+
+    constexpr const_iterator end() const noexcept {
+        return m_table.data() + N;
+    }
+
+    constexpr iterator find(const key_type key) noexcept {
+        const auto i = index_of(key);
+        return ((i < N) && m_table[i].second) ? &m_table[i] : end();
+    }
+
+    constexpr const_iterator find(const key_type key) const noexcept {
+        const auto i = index_of(key);
+        return ((i < N) && m_table[i].second) ? &m_table[i] : end();
+    }
+
+    /** Returns false if the key is out of the table. */
+    template <typename U>
+    constexpr bool insert_or_assign(const key_type key, U&& val) {
+        const auto i = index_of(key);
+        if (i >= N) {
+            return false;
+        }
+        m_table[i] = value_type { key, std::forward<U>(val) };
+        return true;
+    }
+
+    constexpr size_type max_size() const noexcept {
+        return N;
+    }
+};
+
+/** Binds N, for template template parameters taking a map like class. */
+template <std::size_t N>
+struct EnumTableOf final {
+    template <typename K, typename V>
+    using type = EnumTable<K, V, N>;
+};
+
+} // inline namespace enum_table
+
+} // namespace cun
+
+#endif // ndef CUN_ENUM_TABLE_HPP_INCLUDED
@@ -0,0 +1,136 @@
+﻿// -*- coding: utf-8-with-signature-dos -*-
+// vim:fileencoding=utf-8:ff=dos
+//
+// A type-erased value holder with a fixed inline buffer.
+
+#ifndef CUN_INLINE_ANY_HPP_INCLUDED
+#define CUN_INLINE_ANY_HPP_INCLUDED
+
+// C++ standard library
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/* ---------------------------------------------------------------------- */
+/*  */
+/* ---------------------------------------------------------------------- */
+
+namespace cun {
+
+inline namespace inline_any {
+
+/**
+ * A type-erased value holder class like std::any, without dynamic memory
+ * allocation.
+ *
+ * The value is always stored in the inline buffer of SIZE bytes, so a type
+ * which does not fit is rejected at compile time. It is move-only, and the
+ * type check does not need RTTI.
+ */
+template <std::size_t SIZE, std::size_t ALIGN = alignof(std::max_align_t)>
+class InlineAny final {
+    static_assert(SIZE > 0, "InlineAny: 0 size buffer is not allowed.");
+
+public:
+    template <typename T>
+    static constexpr bool fits =
+        (sizeof(T) <= SIZE) &&
+        (ALIGN % alignof(T) == 0) &&
+        std::is_nothrow_move_constructible_v<T>;
+
+private:
+    struct VTable final {
+        void (*destroy)(void *p) noexcept;
+        void (*move)(void *dst, void *src) noexcept;
+    };
+
+    template <typename T>
+    static constexpr VTable VTABLE_OF {
+        [](void *p) noexcept { std::destroy_at(static_cast<T *>(p)); },
+        [](void *dst, void *src) noexcept { std::construct_at(static_cast<T *>(dst), std::move(*static_cast<T *>(src))); },
+    };
+
+    alignas(ALIGN) std::byte m_buf[SIZE];
+    const VTable *m_vtable { nullptr };
+
+    void move_from(InlineAny& other) noexcept {
+        if (other.m_vtable != nullptr) {
+            other.m_vtable->move(m_buf, other.m_buf);
+            m_vtable = other.m_vtable;
+            other.reset();
+        }
+    }
+
+public:
+    InlineAny() noexcept = default;
+
+    template <typename T>
+    requires (!std::is_same_v<std::decay_t<T>, InlineAny>)
+    InlineAny(T&& val) {
+        (void) emplace<std::decay_t<T>>(std::forward<T>(val));
+    }
+
+    ~InlineAny() {
+        reset();
+    }
+
+    InlineAny(const InlineAny&) = delete;
+    InlineAny& operator=(const InlineAny&) = delete;
+
+    InlineAny(InlineAny&& other) noexcept {
+        move_from(other);
+    }
+
+    InlineAny& operator=(InlineAny&& other) noexcept {
+        if (this != &other) {
+            reset();
+            move_from(other);
+        }
+        return *this;
+    }
+
+    template <typename T, typename... Args>
+    T& emplace(Args&& ... args) {
+        static_assert(fits<T>, "InlineAny: the type does not fit in the buffer.");
+
+        reset();
+        auto *p = std::construct_at(reinterpret_cast<T *>(m_buf), std::forward<Args>(args) ...);
+        m_vtable = &VTABLE_OF<T>;
+        return *p;
+    }
+
+    bool has_value() const noexcept {
+        return m_vtable != nullptr;
+    }
+
+    template <typename T>
+    bool holds() const noexcept {
+        return m_vtable == &VTABLE_OF<T>;
+    }
+
+    void reset() noexcept {
+        if (m_vtable != nullptr) {
+            m_vtable->destroy(m_buf);
+            m_vtable = nullptr;
+        }
+    }
+
+    /** Returns nullptr if T is not the type of the value. */
+    template <typename T>
+    T *get_if() noexcept {
+        return holds<T>() ? std::launder(reinterpret_cast<T *>(m_buf)) : nullptr;
+    }
+
+    template <typename T>
+    const T *get_if() const noexcept {
+        return holds<T>() ? std::launder(reinterpret_cast<const T *>(m_buf)) : nullptr;
+    }
+};
+
+} // inline namespace inline_any
+
+} // namespace cun
+
+#endif // ndef CUN_INLINE_ANY_HPP_INCLUDED
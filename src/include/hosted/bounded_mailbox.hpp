@@ -0,0 +1,315 @@
+﻿// -*- coding: utf-8-with-signature-dos -*-
+// vim:fileencoding=utf-8:ff=dos
+//
+// A lock-free bounded inter-thread communication mailbox (MPMC).
+
+#ifndef CUN_BOUNDED_MAILBOX_HPP_INCLUDED
+#define CUN_BOUNDED_MAILBOX_HPP_INCLUDED
+
+// C++ standard library
+#include <atomic>
+#include <chrono>
+#include <concepts>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+
+/* ---------------------------------------------------------------------- */
+/*  */
+/* ---------------------------------------------------------------------- */
+
+namespace cun {
+
+inline namespace bounded_mailbox {
+
+/**
+ * Lock-free bounded inter-thread communication mailbox class (MPMC).
+ *
+ * A sequence-numbered ring buffer (D. Vyukov's bounded MPMC queue).
+ * Producers and consumers only touch the mutex to park themselves
+ * when the mailbox is full (producers) or empty (consumers).
+ * After close(), pushes are rejected and pops return false once the
+ * remaining mails have been drained.
+ */
+template <typename T, std::size_t N>
+requires std::default_initializable<T> &&
+         std::is_nothrow_move_assignable_v<T>
+class BoundedMailbox final {
+    static_assert(N >= 2, "BoundedMailbox: buffer size must be greater than 1.");
+    static_assert((N & (N - 1)) == 0, "BoundedMailbox: buffer size must be a power of 2.");
+    static_assert(N <= (std::numeric_limits<std::size_t>::max() >> 1), "BoundedMailbox: buffer size is too large.");
+
+public:
+    using size_type = std::size_t;
+    using value_type = T;
+
+private:
+    static constexpr size_type CACHE_LINE_SIZE { 64 };
+    static constexpr size_type MASK { N - 1 };
+
+    struct Cell final {
+        std::atomic_size_t seq;
+        value_type data;
+    };
+
+    alignas(CACHE_LINE_SIZE) std::atomic_size_t m_enqueue_pos { 0 };
+    alignas(CACHE_LINE_SIZE) std::atomic_size_t m_dequeue_pos { 0 };
+    alignas(CACHE_LINE_SIZE) Cell m_cells[N];
+
+    alignas(CACHE_LINE_SIZE) std::atomic_bool m_closed { false };
+    std::atomic_uint m_num_pop_waiters { 0 };
+    std::atomic_uint m_num_push_waiters { 0 };
+    std::mutex m_mutex;
+    std::condition_variable m_cond_pop;
+    std::condition_variable m_cond_push;
+
+    static std::intptr_t distance(const size_type seq, const size_type pos) noexcept {
+        return static_cast<std::intptr_t>(seq - pos);
+    }
+
+    bool readable() const noexcept {
+        const auto pos = m_dequeue_pos.load(std::memory_order_seq_cst);
+        return distance(m_cells[pos & MASK].seq.load(std::memory_order_seq_cst), pos + 1) >= 0;
+    }
+
+    bool writable() const noexcept {
+        const auto pos = m_enqueue_pos.load(std::memory_order_seq_cst);
+        return distance(m_cells[pos & MASK].seq.load(std::memory_order_seq_cst), pos) >= 0;
+    }
+
+    void wake(std::atomic_uint& num_waiters, std::condition_variable& cond) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (num_waiters.load(std::memory_order_relaxed) == 0) {
+            return;
+        }
+        // Synchronize with a waiter between its predicate check and its sleep.
+        { std::lock_guard<std::mutex> lck(m_mutex); }
+        cond.notify_one();
+    }
+
+    template <typename PredT>
+    void park(std::atomic_uint& num_waiters, std::condition_variable& cond, PredT pred) {
+        num_waiters.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        {
+            std::unique_lock<std::mutex> lck(m_mutex);
+            cond.wait(lck, pred);
+        }
+        num_waiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    template <typename PredT, typename ClockT, typename DurationT>
+    bool park_until(std::atomic_uint& num_waiters, std::condition_variable& cond, PredT pred,
+                    const std::chrono::time_point<ClockT, DurationT>& abs_time) {
+        num_waiters.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        bool ready;
+        {
+            std::unique_lock<std::mutex> lck(m_mutex);
+            ready = cond.wait_until(lck, abs_time, pred);
+        }
+        num_waiters.fetch_sub(1, std::memory_order_relaxed);
+        return ready;
+    }
+
+    bool enqueue(value_type& val) noexcept {
+        auto pos = m_enqueue_pos.load(std::memory_order_relaxed);
+
+        for (;;) {
+            auto& cell = m_cells[pos & MASK];
+            const auto dif = distance(cell.seq.load(std::memory_order_acquire), pos);
+
+            if (dif == 0) {
+                if (m_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.data = std::move(val);
+                    cell.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (dif < 0) {
+                return false;
+            } else {
+                pos = m_enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool dequeue(value_type& val) noexcept {
+        auto pos = m_dequeue_pos.load(std::memory_order_relaxed);
+
+        for (;;) {
+            auto& cell = m_cells[pos & MASK];
+            const auto dif = distance(cell.seq.load(std::memory_order_acquire), pos + 1);
+
+            if (dif == 0) {
+                if (m_dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    val = std::move(cell.data);
+                    cell.seq.store(pos + MASK + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (dif < 0) {
+                return false;
+            } else {
+                pos = m_dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool is_closed() const noexcept {
+        return m_closed.load(std::memory_order_seq_cst);
+    }
+
+    bool push_value(value_type& val) {
+        if (is_closed()) {
+            return false;
+        }
+        while (!enqueue(val)) {
+            park(m_num_push_waiters, m_cond_push, [this]{ return writable() || is_closed(); });
+            if (is_closed()) {
+                return false;
+            }
+        }
+        wake(m_num_pop_waiters, m_cond_pop);
+        return true;
+    }
+
+    bool try_push_value(value_type& val) {
+        if (is_closed() || !enqueue(val)) {
+            return false;
+        }
+        wake(m_num_pop_waiters, m_cond_pop);
+        return true;
+    }
+
+public:
+    BoundedMailbox() {
+        for (size_type i = 0; i < N; i++) {
+            m_cells[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    BoundedMailbox(const BoundedMailbox&) = delete;
+    BoundedMailbox(BoundedMailbox&&) = delete;
+    BoundedMailbox& operator=(const BoundedMailbox&) = delete;
+    BoundedMailbox& operator=(BoundedMailbox&&) = delete;
+
+    void clear() {
+        value_type val;
+        while (try_pop(val)) {
+            /*EMPTY*/
+        }
+    }
+
+    void close() {
+        m_closed.store(true, std::memory_order_seq_cst);
+        { std::lock_guard<std::mutex> lck(m_mutex); }
+        m_cond_pop.notify_all();
+        m_cond_push.notify_all();
+    }
+
+    bool closed() const noexcept {
+        return is_closed();
+    }
+
+    bool empty() const noexcept {
+        return size() == 0;
+    }
+
+    bool full() const noexcept {
+        return size() >= N;
+    }
+
+    size_type max_size() const noexcept {
+        return N;
+    }
+
+    value_type pop() {
+        value_type val {};
+        (void) pop(val);
+        return val;
+    }
+
+    bool pop(value_type& val) {
+        while (!dequeue(val)) {
+            if (is_closed()) {
+                if (!dequeue(val)) {
+                    return false;
+                }
+                break;
+            }
+            park(m_num_pop_waiters, m_cond_pop, [this]{ return readable() || is_closed(); });
+        }
+        wake(m_num_push_waiters, m_cond_push);
+        return true;
+    }
+
+    template <typename RepT, typename PeriodT>
+    bool pop(value_type& val, const std::chrono::duration<RepT, PeriodT>& timeout) {
+        const auto abs_time = std::chrono::steady_clock::now() + timeout;
+
+        while (!dequeue(val)) {
+            if (is_closed()) {
+                if (!dequeue(val)) {
+                    return false;
+                }
+                break;
+            }
+            if (!park_until(m_num_pop_waiters, m_cond_pop, [this]{ return readable() || is_closed(); }, abs_time)) {
+                return false;
+            }
+        }
+        wake(m_num_push_waiters, m_cond_push);
+        return true;
+    }
+
+    bool push(const value_type& val) {
+        value_type tmp(val);
+        return push_value(tmp);
+    }
+
+    bool push(value_type&& val) {
+        return push_value(val);
+    }
+
+    template <typename... Args>
+    bool emplace(Args&& ... args) {
+        value_type tmp(std::forward<Args>(args) ...);
+        return push_value(tmp);
+    }
+
+    size_type size() const noexcept {
+        const auto rp = m_dequeue_pos.load(std::memory_order_relaxed);
+        const auto wp = m_enqueue_pos.load(std::memory_order_relaxed);
+        const auto n = distance(wp, rp);
+        if (n <= 0) {
+            return 0;
+        }
+        return (static_cast<size_type>(n) > N) ? N : static_cast<size_type>(n);
+    }
+
+    bool try_pop(value_type& val) {
+        if (!dequeue(val)) {
+            return false;
+        }
+        wake(m_num_push_waiters, m_cond_push);
+        return true;
+    }
+
+    bool try_push(const value_type& val) {
+        value_type tmp(val);
+        return try_push_value(tmp);
+    }
+
+    bool try_push(value_type&& val) {
+        return try_push_value(val);
+    }
+};
+
+} // inline namespace bounded_mailbox
+
+} // namespace cun
+
+#endif // ndef CUN_BOUNDED_MAILBOX_HPP_INCLUDED
@@ -0,0 +1,383 @@
+﻿// -*- coding: utf-8-with-signature-dos -*-
+// vim:fileencoding=utf-8:ff=dos
+//
+// An event loop toolbox waiting for file descriptors with epoll (Linux only).
+
+#ifndef EPOLL_EVENT_LOOP_HPP_INCLUDED
+#define EPOLL_EVENT_LOOP_HPP_INCLUDED
+
+#if defined(__linux__)
+
+// C++ standard library
+#include <any>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// POSIX / Linux
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+// C++ user library
+#include "event_loop.hpp"
+
+/* ---------------------------------------------------------------------- */
+/*  */
+/* ---------------------------------------------------------------------- */
+
+namespace cun {
+
+inline namespace epoll_event_loop {
+
+/** The args of an event posted by a readiness of a file descriptor. */
+struct IoEvent final {
+    int fd;
+    std::uint32_t events; // EPOLLIN, EPOLLOUT, etc.
+};
+
+/**
+ * Event loop toolbox class waiting for file descriptors with epoll.
+ *
+ * This is a variant of EventLoop for Linux. The loop thread waits for an
+ * eventfd and the registered file descriptors in one epoll_wait, so that
+ * the handlers of both I/O readiness and posted events run on the loop
+ * thread without any forwarding thread. A readiness of a file descriptor
+ * registered by add_fd is dispatched to the handler of the event type with
+ * IoEvent as its args.
+ *
+ * The eventfd is written only when a mail is queued to the empty queue.
+ * As with EventLoop, send_event called from a handler is handled inline.
+ *
+ * This is a reduced stand-alone loop, not a backend of EventLoop. It does
+ * not have the timers, the deferred queue, the capacity and the overflow
+ * policy, the metrics, the coalescing, nor the coroutine async_send of
+ * EventLoop. Use EventLoop when any of them is needed.
+ */
+template <
+    typename UserEventT,
+    ContextPtr ContextPtrT = void *,
+    RVTraits RVTraitsT = ReturnTraits<bool>,
+    template <typename, typename> class EntryT = std::map
+>
+class EpollEventLoop {
+public:
+    using return_type = typename RVTraitsT::type;
+    using event_proc = std::function<return_type (ContextPtrT, std::any&, std::any&)>;
+    using event_entry = EntryT<UserEventT, event_proc>;
+
+private:
+    using completion_type = CompletionSlot<return_type>;
+    using mail_type = std::tuple<UserEventT, completion_type *, std::any, std::any>;
+
+    static constexpr int MAX_EVENTS_PER_WAKEUP { 32 };
+
+    ContextPtrT m_context;
+    event_entry m_event_entry;
+    int m_epoll { -1 };
+    int m_wakeup { -1 };
+    std::mutex m_mutex;
+    std::deque<mail_type> m_mails;
+    bool m_closed { false };
+    std::map<int, UserEventT> m_watches;
+    std::thread m_thread;
+
+    static const EpollEventLoop *& current_loop() noexcept {
+        static thread_local const EpollEventLoop *loop { nullptr };
+        return loop;
+    }
+
+    bool in_loop_thread() const noexcept {
+        return current_loop() == this;
+    }
+
+    [[noreturn]] static void throw_errno() {
+        throw std::system_error { errno, std::generic_category() };
+    }
+
+    void open_fds() {
+        m_epoll = ::epoll_create1(EPOLL_CLOEXEC);
+        if (m_epoll < 0) {
+            throw_errno();
+        }
+        m_wakeup = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (m_wakeup < 0) {
+            const auto err = errno;
+            (void) ::close(m_epoll);
+            throw std::system_error { err, std::generic_category() };
+        }
+        epoll_event ev {};
+        ev.events = EPOLLIN;
+        ev.data.fd = m_wakeup;
+        if (::epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wakeup, &ev) < 0) {
+            const auto err = errno;
+            close_fds();
+            throw std::system_error { err, std::generic_category() };
+        }
+    }
+
+    void close_fds() noexcept {
+        (void) ::close(m_wakeup);
+        (void) ::close(m_epoll);
+    }
+
+    void wake() noexcept {
+        const std::uint64_t one { 1 };
+        (void) ::write(m_wakeup, &one, sizeof(one));
+    }
+
+    return_type dispatch(const UserEventT request, std::any& args, std::any& results) {
+        auto p = m_event_entry.find(request);
+        if (p == m_event_entry.end()) {
+            return RVTraitsT::event_not_found();
+        }
+        return p->second(m_context, args, results);
+    }
+
+    void handle(mail_type& mail) {
+        using std::get;
+
+        const auto retval = dispatch(get<0>(mail), get<2>(mail), get<3>(mail));
+
+        if (auto *completion = get<1>(mail); completion != nullptr) {
+            completion->set_value(retval);
+        }
+    }
+
+    void handle_io(const epoll_event& ev) {
+        UserEventT type {};
+        {
+            std::lock_guard<std::mutex> lck { m_mutex };
+            auto p = m_watches.find(ev.data.fd);
+            if (p == m_watches.end()) {
+                // Removed after epoll_wait.
+                return;
+            }
+            type = p->second;
+        }
+        std::any args { IoEvent { ev.data.fd, ev.events } };
+        std::any results;
+        (void) dispatch(type, args, results);
+    }
+
+    // Returns false if the loop is closed.
+    bool handle_mails(std::deque<mail_type>& mails) {
+        std::uint64_t count;
+        (void) ::read(m_wakeup, &count, sizeof(count));
+
+        bool closed;
+        {
+            std::lock_guard<std::mutex> lck { m_mutex };
+            mails.swap(m_mails);
+            closed = m_closed;
+        }
+        for (; !mails.empty(); mails.pop_front()) {
+            handle(mails.front());
+        }
+        return !closed;
+    }
+
+    // Closes the loop and fails the queued mails, when epoll_wait is broken.
+    void abandon_mails() noexcept {
+        std::deque<mail_type> mails;
+        {
+            std::lock_guard<std::mutex> lck { m_mutex };
+            m_closed = true;
+            mails.swap(m_mails);
+        }
+        for (auto& mail : mails) {
+            if (auto *completion = std::get<1>(mail); completion != nullptr) {
+                completion->set_value(RVTraitsT::ng());
+            }
+        }
+    }
+
+    void main_loop() noexcept {
+        current_loop() = this;
+
+        epoll_event events[MAX_EVENTS_PER_WAKEUP];
+        std::deque<mail_type> mails;
+
+        for (;;) {
+            const auto n = ::epoll_wait(m_epoll, events, MAX_EVENTS_PER_WAKEUP, -1);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                abandon_mails();
+                break;
+            }
+            bool woken { false };
+            for (auto i = 0; i < n; i++) {
+                if (events[i].data.fd == m_wakeup) {
+                    woken = true;
+                } else {
+                    handle_io(events[i]);
+                }
+            }
+            if (woken && !handle_mails(mails)) {
+                break;
+            }
+        }
+    }
+
+    bool enqueue(mail_type&& mail) {
+        bool was_empty;
+        {
+            std::lock_guard<std::mutex> lck { m_mutex };
+            if (m_closed) {
+                return false;
+            }
+            was_empty = m_mails.empty();
+            m_mails.push_back(std::move(mail));
+        }
+        if (was_empty) {
+            wake();
+        }
+        return true;
+    }
+
+    return_type send_mail(const UserEventT type, std::any&& args, std::any&& results) noexcept {
+        try {
+            if (in_loop_thread()) {
+                // Waiting for ourselves would never end.
+                return dispatch(type, args, results);
+            }
+            completion_type completion;
+            if (!enqueue(std::make_tuple(type, &completion, std::move(args), std::move(results)))) {
+                return RVTraitsT::ng();
+            }
+            return completion.wait();
+        } catch (...) {
+            return RVTraitsT::ng();
+        }
+    }
+
+    return_type post_mail(const UserEventT type, std::any&& args) noexcept {
+        try {
+            if (!enqueue(std::make_tuple(type, static_cast<completion_type *>(nullptr),
+                                         std::move(args), std::any {}))) {
+                return RVTraitsT::ng();
+            }
+            return RVTraitsT::ok();
+        } catch (...) {
+            return RVTraitsT::ng();
+        }
+    }
+
+    bool control_fd(const int op, const int fd, const std::uint32_t events) noexcept {
+        epoll_event ev {};
+        ev.events = events;
+        ev.data.fd = fd;
+        return ::epoll_ctl(m_epoll, op, fd, &ev) == 0;
+    }
+
+public:
+    /** Throws std::system_error if epoll or eventfd is not available. */
+    explicit EpollEventLoop(event_entry&& event_entry = {},
+                            ContextPtrT context = nullptr) :
+            m_context { context },
+            m_event_entry { std::move(event_entry) } {
+        open_fds();
+        m_thread = std::thread { [this]{ main_loop(); } };
+    }
+
+    explicit EpollEventLoop(const event_entry& event_entry,
+                            ContextPtrT context = nullptr) :
+            m_context { context },
+            m_event_entry { event_entry } {
+        open_fds();
+        m_thread = std::thread { [this]{ main_loop(); } };
+    }
+
+    virtual ~EpollEventLoop() {
+        {
+            std::lock_guard<std::mutex> lck { m_mutex };
+            m_closed = true;
+        }
+        wake();
+        m_thread.join();
+        close_fds();
+    }
+
+    /**
+     * Dispatches the readiness of fd to the handler of type.
+     * The fd is not owned: remove it before closing it.
+     */
+    bool add_fd(const int fd, const std::uint32_t events, const UserEventT type) noexcept {
+        try {
+            std::lock_guard<std::mutex> lck { m_mutex };
+            if (!m_watches.emplace(fd, type).second) {
+                return false;
+            }
+            if (!control_fd(EPOLL_CTL_ADD, fd, events)) {
+                m_watches.erase(fd);
+                return false;
+            }
+            return true;
+        } catch (...) {
+            return false;
+        }
+    }
+
+    bool modify_fd(const int fd, const std::uint32_t events) noexcept {
+        return control_fd(EPOLL_CTL_MOD, fd, events);
+    }
+
+    /**
+     * A readiness being dispatched at the moment may still reach the handler,
+     * unless this is called on the loop thread (e.g. by a handler).
+     */
+    bool remove_fd(const int fd) noexcept {
+        std::lock_guard<std::mutex> lck { m_mutex };
+        if (m_watches.erase(fd) == 0) {
+            return false;
+        }
+        return control_fd(EPOLL_CTL_DEL, fd, 0);
+    }
+
+    template <typename ArgsT, typename ResultsT>
+    return_type send_event(const UserEventT type, ArgsT&& args, ResultsT&& results) noexcept {
+        return send_mail(type,
+                         std::make_any<std::decay_t<ArgsT>>(std::forward<ArgsT>(args)),
+                         std::make_any<std::decay_t<ResultsT>>(std::forward<ResultsT>(results)));
+    }
+
+    template <typename ArgsT>
+    return_type send_event(const UserEventT type, ArgsT&& args) noexcept {
+        return send_mail(type,
+                         std::make_any<std::decay_t<ArgsT>>(std::forward<ArgsT>(args)),
+                         std::any {});
+    }
+
+    return_type send_event(const UserEventT type) noexcept {
+        return send_mail(type, std::any {}, std::any {});
+    }
+
+    template <typename ArgsT>
+    return_type post_event(const UserEventT type, ArgsT&& args) noexcept {
+        return post_mail(type,
+                         std::make_any<std::decay_t<ArgsT>>(std::forward<ArgsT>(args)));
+    }
+
+    return_type post_event(const UserEventT type) noexcept {
+        return post_mail(type, std::any {});
+    }
+};
+
+} // inline namespace epoll_event_loop
+
+} // namespace cun
+
+#endif // defined(__linux__)
+
+#endif // ndef EPOLL_EVENT_LOOP_HPP_INCLUDED
@@ -7,21 +7,32 @@
 #define EVENT_LOOP_HPP_INCLUDED
 
 // C++ standard library
+#include <algorithm>
 #include <any>
-#include <cassert>
+#include <bit>
+#include <atomic>
+#include <chrono>
 #include <concepts>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
 #include <functional>
-#include <future>
 #include <map>
+#include <mutex>
 #include <optional>
+#include <queue>
 #include <thread>
 #include <tuple>
 #include <type_traits>
 #include <utility>
-#include <variant>
+#include <vector>
 
 // C++ user library
+#include "enum_table.hpp"
 #include "mailbox.hpp"
+#include "time_measuring.hpp"
 
 /* ---------------------------------------------------------------------- */
 /*  */
@@ -69,84 +80,578 @@ struct ReturnTraits<bool> {
     static type event_not_found() noexcept { return false; }
 };
 
-/** Event loop toolbox class. */
+/** What post_event of EventLoop does while its mailbox is full. */
+enum class OverflowPolicy {
+    block,       /**< Wait until the loop pops a mail. */
+    fail,        /**< Return RVTraitsT::ng(). */
+    drop_oldest, /**< Discard the oldest posted event, except coalescing ones. */
+    coalesce,    /**< Replace the newest posted event of the same type, or fail if there is none. */
+};
+
+/** A snapshot of the metrics of an event type. */
+struct EventMetrics final {
+    using duration = std::chrono::nanoseconds;
+
+    /** The reports are made from the latest MAX_LOG events. */
+    static constexpr std::size_t MAX_LOG { 256 };
+    using log_type = DurationLog<MAX_LOG, duration>;
+    using report_type = log_type::report_type;
+
+    /** Bucket 0 counts durations under 1us, bucket i counts [2^(i-1), 2^i) us. */
+    static constexpr std::size_t NUM_BUCKETS { 32 };
+
+    std::uint64_t num_events;
+
+    /** From posting (or the deadline of a timer) to the start of the handler. */
+    report_type wait;
+    std::uint64_t wait_histogram[NUM_BUCKETS];
+
+    /** Execution time of the handler. */
+    report_type run;
+    std::uint64_t run_histogram[NUM_BUCKETS];
+};
+
+/** An interface to receive the result of an event. */
+template <typename T>
+class CompletionHandler {
+public:
+    virtual void set_value(const T& value) noexcept = 0;
+
+protected:
+    ~CompletionHandler() = default;
+};
+
+/**
+ * A one-shot completion slot for a synchronous request.
+ *
+ * The requester owns the slot (usually on its stack) and waits on it with
+ * std::atomic::wait, so no shared state is allocated as std::promise does.
+ */
+template <typename T>
+class CompletionSlot final : public CompletionHandler<T> {
+private:
+    enum : std::uint32_t {
+        pending,
+        done,
+        released
+    };
+
+    std::optional<T> m_value;
+    std::atomic_uint32_t m_state { pending };
+
+public:
+    CompletionSlot() = default;
+
+    CompletionSlot(const CompletionSlot&) = delete;
+    CompletionSlot& operator=(const CompletionSlot&) = delete;
+
+    void set_value(const T& value) noexcept override {
+        m_value.emplace(value);
+        m_state.store(done, std::memory_order_release);
+        m_state.notify_one();
+        // The requester may destroy the slot once it sees this.
+        m_state.store(released, std::memory_order_release);
+    }
+
+    T wait() noexcept {
+        for (;;) {
+            const auto state = m_state.load(std::memory_order_acquire);
+            if (state == released) {
+                return *m_value;
+            }
+            if (state == pending) {
+                m_state.wait(pending, std::memory_order_acquire);
+            } else {
+                // The other side is just leaving notify_one.
+                std::this_thread::yield();
+            }
+        }
+    }
+};
+
+/** An interface to resume coroutines on the thread of an event loop. */
+class CoroutineExecutor {
+public:
+    /** Returns the executor running on the current thread, or nullptr. */
+    static CoroutineExecutor *& current() noexcept {
+        static thread_local CoroutineExecutor *executor { nullptr };
+        return executor;
+    }
+
+    /** Returns false if the handle cannot be resumed later (e.g. closed). */
+    virtual bool schedule(std::coroutine_handle<> handle) noexcept = 0;
+
+protected:
+    ~CoroutineExecutor() = default;
+};
+
+/**
+ * A coroutine type which starts immediately and destroys itself at the end.
+ *
+ * It is the simplest way to write a coroutine which uses async_send, e.g.
+ * called from a handler so that it is resumed on the loop of the handler.
+ */
+struct DetachedTask final {
+    struct promise_type final {
+        DetachedTask get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+/**
+ * Event loop toolbox class.
+ *
+ * The handlers are looked up in EntryT<UserEventT, event_proc>: std::map by
+ * default, or EnumTableOf<N>::type for a dense enumeration.
+ *
+ * When a handler calls send_event of its own loop, the event is handled
+ * inline. When it calls post_event, the event is queued in a deferred queue
+ * private to the loop thread, which is drained before the next mailbox pop.
+ *
+ * async_send returns an awaitable for C++20 coroutines. The awaiting
+ * coroutine is resumed on the loop it was running on when it awaited
+ * (or on this loop if it was not running on any loop), so that loop must
+ * outlive this loop while the coroutine is waiting.
+ *
+ * post_event_after / post_event_at / post_event_every post an event later
+ * without any extra thread: the timers are kept in a heap, and the loop
+ * thread pops the mailbox with the time left until the nearest deadline.
+ * A periodic timer which falls behind skips the missed ticks.
+ *
+ * If ENABLE_METRICS is true, the loop records EventMetrics per event type;
+ * otherwise the metrics are compiled out.
+ *
+ * set_capacity limits the mailbox, and post_event follows OverflowPolicy
+ * while it is full. send_event, async_send and the timers are not limited,
+ * nor post_event called from a handler (it does not use the mailbox).
+ *
+ * For an event type set by set_coalescing, post_event replaces the args of
+ * the pending event of the type instead of queuing another one, so at most
+ * one event per type is pending. These events are not limited either.
+ */
 template <
     typename UserEventT,
     ContextPtr ContextPtrT = void *,
-    RVTraits RVTraitsT = ReturnTraits<bool>
+    RVTraits RVTraitsT = ReturnTraits<bool>,
+    template <typename, typename> class EntryT = std::map,
+    bool ENABLE_METRICS = false
 >
-class EventLoop {
+class EventLoop : private CoroutineExecutor {
 public:
     using return_type = typename RVTraitsT::type;
     using event_proc = std::function<return_type (ContextPtrT, std::any&, std::any&)>;
-    using event_entry = std::map<UserEventT, event_proc>;
+    using event_entry = EntryT<UserEventT, event_proc>;
+    using clock_type = std::chrono::steady_clock;
+    using timer_id = std::uint64_t;
+
+    class SendAwaiter;
 
 private:
-    enum class InternalEvent {
-        destroy
+    using completion_type = CompletionSlot<return_type>;
+    using handler_type = CompletionHandler<return_type>;
+
+    // A mail with a coroutine handle only resumes the coroutine.
+    // The time point is when it is posted, recorded only if ENABLE_METRICS is true.
+    using mail_type = std::tuple<UserEventT, handler_type *, std::any, std::any, std::coroutine_handle<>, clock_type::time_point>;
+
+    struct Timer final {
+        UserEventT type;
+        std::any args;
+        clock_type::duration period; // Zero for a one-shot timer.
+    };
+
+    // Cancelled timers leave their deadlines in the heap, skipped lazily.
+    using deadline_type = std::pair<clock_type::time_point, timer_id>;
+    using deadline_heap = std::priority_queue<deadline_type, std::vector<deadline_type>, std::greater<>>;
+
+    struct Metrics final {
+        std::uint64_t num_events { 0 };
+        EventMetrics::log_type wait;
+        EventMetrics::log_type run;
+        std::uint64_t wait_histogram[EventMetrics::NUM_BUCKETS] {};
+        std::uint64_t run_histogram[EventMetrics::NUM_BUCKETS] {};
+    };
+
+    struct MetricsTable final {
+        mutable std::mutex mutex;
+        std::map<UserEventT, Metrics> table;
     };
-    using event_type = std::variant<InternalEvent, UserEventT>;
-    using promise_type = std::promise<return_type>;
-    using mail_type = std::tuple<event_type, std::optional<promise_type>, std::any, std::any>;
+
+    struct NoMetrics final {};
+
+    static constexpr std::size_t MAX_MAILS_PER_WAKEUP { 32 };
 
     ContextPtrT m_context;
     Mailbox<mail_type> m_mailbox;
     event_entry m_event_entry;
+    std::deque<mail_type> m_deferred; // Only touched by the loop thread.
+    std::atomic_size_t m_capacity { 0 };
+    std::atomic<OverflowPolicy> m_overflow_policy { OverflowPolicy::block };
+    std::mutex m_coalesce_mutex;
+    std::map<UserEventT, std::optional<std::any>> m_coalesced; // The args of the pending event, if any.
+    std::atomic_bool m_coalescing { false };
+    [[no_unique_address]] std::conditional_t<ENABLE_METRICS, MetricsTable, NoMetrics> m_metrics;
+    std::mutex m_timer_mutex;
+    deadline_heap m_deadlines;
+    std::map<timer_id, Timer> m_timers;
+    timer_id m_last_timer_id { 0 };
     std::thread m_thread;
 
-    void main_loop() noexcept {
+    bool in_loop_thread() const noexcept {
+        return CoroutineExecutor::current() == this;
+    }
+
+    static clock_type::time_point stamp() noexcept {
+        if constexpr (ENABLE_METRICS) {
+            return clock_type::now();
+        } else {
+            return {};
+        }
+    }
+
+    static void record_duration(EventMetrics::log_type& log, std::uint64_t (&histogram)[EventMetrics::NUM_BUCKETS],
+                                const clock_type::duration value) noexcept {
+        const auto d = std::max(std::chrono::duration_cast<EventMetrics::duration>(value), EventMetrics::duration::zero());
+        log.record(d);
+        const auto us = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(d).count());
+        histogram[std::min<std::size_t>(std::bit_width(us), EventMetrics::NUM_BUCKETS - 1)]++;
+    }
+
+    /** posted is the time point when the event is posted, or its deadline. */
+    return_type dispatch(const UserEventT request, std::any& args, std::any& results,
+                         [[maybe_unused]] const clock_type::time_point posted) {
+        const auto begin = stamp();
+
+        auto retval = RVTraitsT::event_not_found();
+        auto p = m_event_entry.find(request);
+        if (p != m_event_entry.end()) {
+            retval = p->second(m_context, args, results);
+        }
+
+        if constexpr (ENABLE_METRICS) {
+            const auto end = clock_type::now();
+            std::lock_guard<std::mutex> lck { m_metrics.mutex };
+            auto& metrics = m_metrics.table[request];
+            metrics.num_events++;
+            record_duration(metrics.wait, metrics.wait_histogram, begin - posted);
+            record_duration(metrics.run, metrics.run_histogram, end - begin);
+        }
+        return retval;
+    }
+
+    void handle(mail_type& mail) {
         using std::get;
 
+        if (auto coroutine = get<4>(mail); coroutine) {
+            mail = mail_type {};
+            coroutine.resume();
+            return;
+        }
+
+        if (is_posted(mail)) {
+            take_coalesced(get<0>(mail), get<2>(mail));
+        }
+
+        const auto retval = dispatch(get<0>(mail), get<2>(mail), get<3>(mail), get<5>(mail));
+
+        if (auto *completion = get<1>(mail); completion != nullptr) {
+            completion->set_value(retval);
+        }
+
+        mail = mail_type {};
+    }
+
+    void drain_deferred() {
+        while (!m_deferred.empty()) {
+            auto mail = std::move(m_deferred.front());
+            m_deferred.pop_front();
+            handle(mail);
+        }
+    }
+
+    // Requires m_timer_mutex to be locked.
+    bool skip_cancelled_timers() {
+        while (!m_deadlines.empty() && !m_timers.contains(m_deadlines.top().second)) {
+            m_deadlines.pop();
+        }
+        return !m_deadlines.empty();
+    }
+
+    std::optional<clock_type::time_point> next_deadline() {
+        std::lock_guard<std::mutex> lck { m_timer_mutex };
+        if (!skip_cancelled_timers()) {
+            return std::nullopt;
+        }
+        return m_deadlines.top().first;
+    }
+
+    void fire_timers() {
         for (;;) {
-            mail_type mail;
+            UserEventT type {};
+            std::any args;
+            clock_type::time_point deadline;
+            {
+                std::lock_guard<std::mutex> lck { m_timer_mutex };
+                if (!skip_cancelled_timers()) {
+                    return;
+                }
+                const auto id = m_deadlines.top().second;
+                deadline = m_deadlines.top().first;
+                const auto now = clock_type::now();
+                if (deadline > now) {
+                    return;
+                }
+                m_deadlines.pop();
+
+                auto p = m_timers.find(id);
+                auto& timer = p->second;
+                type = timer.type;
+                if (timer.period == clock_type::duration::zero()) {
+                    args = std::move(timer.args);
+                    m_timers.erase(p);
+                } else {
+                    args = timer.args;
+                    auto next = deadline + timer.period;
+                    if (next <= now) {
+                        next = now + timer.period;
+                    }
+                    m_deadlines.emplace(next, id);
+                }
+            }
+            std::any results;
+            (void) dispatch(type, args, results, deadline);
+        }
+    }
 
-            m_mailbox.pop(mail);
-            const auto event = get<0>(mail);
-            if (std::holds_alternative<InternalEvent>(event)) {
-                assert(get<InternalEvent>(event) == InternalEvent::destroy);
-                break;
+    timer_id add_timer(const clock_type::time_point deadline, const clock_type::duration period,
+                       const UserEventT type, std::any&& args) noexcept {
+        try {
+            if (m_mailbox.closed()) {
+                return 0;
+            }
+            timer_id id;
+            bool earliest;
+            {
+                std::lock_guard<std::mutex> lck { m_timer_mutex };
+                id = ++m_last_timer_id;
+                m_timers.emplace(id, Timer { type, std::move(args), period });
+                m_deadlines.emplace(deadline, id);
+                earliest = (m_deadlines.top().second == id);
+            }
+            if (earliest && !in_loop_thread()) {
+                // Wake the loop up to shorten its wait, with a mail doing nothing.
+                (void) schedule(std::noop_coroutine());
             }
+            return id;
+        } catch (...) {
+            return 0;
+        }
+    }
 
-            assert(std::holds_alternative<UserEventT>(event));
-            const auto request = get<UserEventT>(event);
+    void main_loop() noexcept {
+        CoroutineExecutor::current() = this;
 
-            auto retval = RVTraitsT::event_not_found();
-            auto p = m_event_entry.find(request);
-            if (p != m_event_entry.end()) {
-                retval = p->second(m_context, get<2>(mail), get<3>(mail));
-            }
+        mail_type mails[MAX_MAILS_PER_WAKEUP];
 
-            if (auto pr = std::move(get<1>(mail)); pr) {
-                pr->set_value(retval);
+        for (;;) {
+            fire_timers();
+            drain_deferred();
+            const auto deadline = next_deadline();
+            const auto n = deadline
+                         ? m_mailbox.pop_n(mails, MAX_MAILS_PER_WAKEUP, *deadline - clock_type::now())
+                         : m_mailbox.pop_n(mails, MAX_MAILS_PER_WAKEUP);
+            // The mailbox returns no mail without timeout only after it is closed and drained.
+            if ((n == 0) && m_mailbox.closed()) {
+                break;
+            }
+            for (std::size_t i = 0; i < n; i++) {
+                handle(mails[i]);
             }
         }
     }
 
-    return_type send_event(event_type&& type, std::any&& args, std::any&& results) noexcept {
+    return_type send_mail(const UserEventT type, std::any&& args, std::any&& results) noexcept {
         try {
-            promise_type pr;
-            auto fu = pr.get_future();
-            auto mail = std::make_tuple(std::move(type), std::make_optional(std::move(pr)),
-                                        std::move(args), std::move(results));
-            m_mailbox.emplace(std::move(mail));
-            return fu.get();
+            if (in_loop_thread()) {
+                // Waiting for ourselves would never end.
+                return dispatch(type, args, results, stamp());
+            }
+            completion_type completion;
+            auto mail = std::make_tuple(type, static_cast<handler_type *>(&completion),
+                                        std::move(args), std::move(results), std::coroutine_handle<> {}, stamp());
+            if (!m_mailbox.emplace(std::move(mail))) {
+                return RVTraitsT::ng();
+            }
+            return completion.wait();
         } catch (...) {
             return RVTraitsT::ng();
         }
     }
 
-    return_type post_event(event_type&& type, std::any&& args) noexcept {
+    static bool is_posted(const mail_type& mail) noexcept {
+        return (std::get<1>(mail) == nullptr) && !std::get<4>(mail);
+    }
+
+    /** Returns std::nullopt if type does not coalesce, or whether the pending event is replaced. */
+    std::optional<bool> coalesce(const UserEventT type, std::any& args) {
+        if (!m_coalescing.load(std::memory_order_relaxed)) {
+            return std::nullopt;
+        }
+        std::lock_guard<std::mutex> lck { m_coalesce_mutex };
+        auto p = m_coalesced.find(type);
+        if (p == m_coalesced.end()) {
+            return std::nullopt;
+        }
+        const auto replaced = p->second.has_value();
+        p->second = std::move(args);
+        return replaced;
+    }
+
+    bool is_coalescing(const UserEventT type) {
+        if (!m_coalescing.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lck { m_coalesce_mutex };
+        return m_coalesced.contains(type);
+    }
+
+    void take_coalesced(const UserEventT type, std::any& args) {
+        if (!m_coalescing.load(std::memory_order_relaxed)) {
+            return;
+        }
+        std::lock_guard<std::mutex> lck { m_coalesce_mutex };
+        auto p = m_coalesced.find(type);
+        if ((p != m_coalesced.end()) && p->second.has_value()) {
+            args = std::move(*p->second);
+            p->second.reset();
+        }
+    }
+
+    bool push_posted(mail_type&& mail, const bool may_block) {
+        const auto capacity = m_capacity.load(std::memory_order_relaxed);
+        if (capacity == 0) {
+            return m_mailbox.emplace(std::move(mail));
+        }
+        switch (m_overflow_policy.load(std::memory_order_relaxed)) {
+        case OverflowPolicy::block:
+            if (may_block) {
+                return m_mailbox.push_bounded(std::move(mail), capacity);
+            }
+            break;
+        case OverflowPolicy::fail:
+            break;
+        case OverflowPolicy::drop_oldest:
+            // The mail of a coalescing event must stay, or its pending args are never dispatched.
+            return m_mailbox.push_bounded_dropping(std::move(mail), capacity, [this](const mail_type& queued) {
+                return is_posted(queued) && !is_coalescing(std::get<0>(queued));
+            });
+        case OverflowPolicy::coalesce:
+            return m_mailbox.push_bounded_replacing(std::move(mail), capacity, [type = std::get<0>(mail)](const mail_type& queued) {
+                return is_posted(queued) && (std::get<0>(queued) == type);
+            });
+        }
+        return m_mailbox.try_push_bounded(std::move(mail), capacity);
+    }
+
+    return_type post_mail(const UserEventT type, std::any&& args, const bool may_block = true) noexcept {
         try {
-            auto mail = std::make_tuple(std::move(type), std::optional<promise_type> {},
-                                        std::move(args), std::any {});
-            m_mailbox.emplace(std::move(mail));
+            const auto coalesced = coalesce(type, args);
+            if (coalesced && *coalesced) {
+                return RVTraitsT::ok();
+            }
+            // The args of a coalescing event are taken from m_coalesced by the loop.
+            auto mail = std::make_tuple(type, static_cast<handler_type *>(nullptr),
+                                        std::move(args), std::any {}, std::coroutine_handle<> {}, stamp());
+            if (in_loop_thread()) {
+                m_deferred.push_back(std::move(mail));
+                return RVTraitsT::ok();
+            }
+            if (coalesced) {
+                // Not limited, so that a replaced event never misses its mail.
+                return m_mailbox.emplace(std::move(mail)) ? RVTraitsT::ok() : RVTraitsT::ng();
+            }
+            if (!push_posted(std::move(mail), may_block)) {
+                return RVTraitsT::ng();
+            }
             return RVTraitsT::ok();
         } catch (...) {
             return RVTraitsT::ng();
         }
     }
 
+    bool schedule(std::coroutine_handle<> handle) noexcept override {
+        try {
+            auto mail = std::make_tuple(UserEventT {}, static_cast<handler_type *>(nullptr),
+                                        std::any {}, std::any {}, handle, clock_type::time_point {});
+            if (in_loop_thread()) {
+                m_deferred.push_back(std::move(mail));
+                return true;
+            }
+            return m_mailbox.emplace(std::move(mail));
+        } catch (...) {
+            return false;
+        }
+    }
+
 public:
+    /** An awaitable of async_send. */
+    class SendAwaiter final : private handler_type {
+    private:
+        EventLoop& m_loop;
+        UserEventT m_type;
+        std::any m_args;
+        std::any m_results;
+        CoroutineExecutor *m_origin { nullptr };
+        std::coroutine_handle<> m_coroutine;
+        std::optional<return_type> m_retval;
+
+        // Called on the thread of the target loop.
+        void set_value(const return_type& value) noexcept override {
+            m_retval.emplace(value);
+            if ((m_origin == nullptr) || !m_origin->schedule(m_coroutine)) {
+                m_coroutine.resume();
+            }
+        }
+
+    public:
+        SendAwaiter(EventLoop& loop, const UserEventT type, std::any&& args, std::any&& results) :
+            m_loop { loop },
+            m_type { type },
+            m_args { std::move(args) },
+            m_results { std::move(results) } {}
+
+        SendAwaiter(const SendAwaiter&) = delete;
+        SendAwaiter& operator=(const SendAwaiter&) = delete;
+
+        bool await_ready() const noexcept {
+            return false;
+        }
+
+        bool await_suspend(std::coroutine_handle<> coroutine) noexcept {
+            m_coroutine = coroutine;
+            m_origin = CoroutineExecutor::current();
+            try {
+                auto mail = std::make_tuple(m_type, static_cast<handler_type *>(this),
+                                            std::move(m_args), std::move(m_results), std::coroutine_handle<> {}, stamp());
+                if (m_loop.m_mailbox.emplace(std::move(mail))) {
+                    // The coroutine may already be resumed: do not touch this anymore.
+                    return true;
+                }
+            } catch (...) {
+                /*EMPTY*/
+            }
+            m_retval.emplace(RVTraitsT::ng());
+            return false;
+        }
+
+        return_type await_resume() noexcept {
+            return *m_retval;
+        }
+    };
+
     explicit EventLoop(event_entry&& event_entry = {},
                        ContextPtrT context = nullptr) :
             m_context { context },
@@ -162,40 +667,163 @@ public:
     }
 
     virtual ~EventLoop() {
-        const auto rc = post_event(event_type { InternalEvent::destroy }, std::any {});
-        if (rc == RVTraitsT::ok()) {
-            m_thread.join();
-        } else {
-            m_thread.detach();
-        }
+        m_mailbox.close();
+        m_thread.join();
     }
 
     template <typename ArgsT, typename ResultsT>
     return_type send_event(const UserEventT type, ArgsT&& args, ResultsT&& results) noexcept {
-        return send_event(event_type { type },
-                          std::make_any<std::decay_t<ArgsT>>(std::forward<ArgsT>(args)),
-                          std::make_any<std::decay_t<ResultsT>>(std::forward<ResultsT>(results)));
+        return send_mail(type,
+                         std::make_any<std::decay_t<ArgsT>>(std::forward<ArgsT>(args)),
+                         std::make_any<std::decay_t<ResultsT>>(std::forward<ResultsT>(results)));
     }
 
     template <typename ArgsT>
     return_type send_event(const UserEventT type, ArgsT&& args) noexcept {
-        return send_event(event_type { type },
-                          std::make_any<std::decay_t<ArgsT>>(std::forward<ArgsT>(args)),
-                          std::any {});
+        return send_mail(type,
+                         std::make_any<std::decay_t<ArgsT>>(std::forward<ArgsT>(args)),
+                         std::any {});
     }
 
     return_type send_event(const UserEventT type) noexcept {
-        return send_event(event_type { type }, std::any {}, std::any {});
+        return send_mail(type, std::any {}, std::any {});
+    }
+
+    template <typename ArgsT, typename ResultsT>
+    SendAwaiter async_send(const UserEventT type, ArgsT&& args, ResultsT&& results) {
+        return SendAwaiter { *this, type,
+                             std::make_any<std::decay_t<ArgsT>>(std::forward<ArgsT>(args)),
+                             std::make_any<std::decay_t<ResultsT>>(std::forward<ResultsT>(results)) };
+    }
+
+    template <typename ArgsT>
+    SendAwaiter async_send(const UserEventT type, ArgsT&& args) {
+        return SendAwaiter { *this, type,
+                             std::make_any<std::decay_t<ArgsT>>(std::forward<ArgsT>(args)),
+                             std::any {} };
+    }
+
+    SendAwaiter async_send(const UserEventT type) {
+        return SendAwaiter { *this, type, std::any {}, std::any {} };
     }
 
     template <typename ArgsT>
     return_type post_event(const UserEventT type, ArgsT&& args) noexcept {
-        return post_event(event_type { type },
-                          std::make_any<std::decay_t<ArgsT>>(std::forward<ArgsT>(args)));
+        return post_mail(type,
+                         std::make_any<std::decay_t<ArgsT>>(std::forward<ArgsT>(args)));
     }
 
     return_type post_event(const UserEventT type) noexcept {
-        return post_event(event_type { type }, std::any {});
+        return post_mail(type, std::any {});
+    }
+
+    /** Same as post_event, but fails instead of blocking while the mailbox is full. */
+    template <typename ArgsT>
+    return_type try_post_event(const UserEventT type, ArgsT&& args) noexcept {
+        return post_mail(type,
+                         std::make_any<std::decay_t<ArgsT>>(std::forward<ArgsT>(args)),
+                         false);
+    }
+
+    return_type try_post_event(const UserEventT type) noexcept {
+        return post_mail(type, std::any {}, false);
+    }
+
+    /**
+     * Set it before posting events of the type. Disabling fails while an
+     * event of the type is pending, since its mail carries no args.
+     */
+    bool set_coalescing(const UserEventT type, const bool enabled = true) {
+        std::lock_guard<std::mutex> lck { m_coalesce_mutex };
+        if (enabled) {
+            (void) m_coalesced.try_emplace(type);
+        } else {
+            auto p = m_coalesced.find(type);
+            if (p != m_coalesced.end()) {
+                if (p->second.has_value()) {
+                    return false;
+                }
+                m_coalesced.erase(p);
+            }
+        }
+        m_coalescing.store(!m_coalesced.empty(), std::memory_order_relaxed);
+        return true;
+    }
+
+    /** Limits the mails in the mailbox for post_event. 0 means no limit (default). */
+    void set_capacity(const std::size_t capacity, const OverflowPolicy policy = OverflowPolicy::block) noexcept {
+        m_overflow_policy.store(policy, std::memory_order_relaxed);
+        m_capacity.store(capacity, std::memory_order_relaxed);
+    }
+
+    std::map<UserEventT, EventMetrics> metrics() const requires ENABLE_METRICS {
+        std::map<UserEventT, EventMetrics> snapshot;
+        std::lock_guard<std::mutex> lck { m_metrics.mutex };
+        for (const auto& [type, metrics] : m_metrics.table) {
+            EventMetrics report {};
+            report.num_events = metrics.num_events;
+            (void) metrics.wait.make_report(report.wait);
+            (void) metrics.run.make_report(report.run);
+            std::copy(std::begin(metrics.wait_histogram), std::end(metrics.wait_histogram), report.wait_histogram);
+            std::copy(std::begin(metrics.run_histogram), std::end(metrics.run_histogram), report.run_histogram);
+            snapshot.emplace(type, report);
+        }
+        return snapshot;
+    }
+
+    void reset_metrics() requires ENABLE_METRICS {
+        std::lock_guard<std::mutex> lck { m_metrics.mutex };
+        m_metrics.table.clear();
+    }
+
+    /** Returns the id of the timer, or 0 on failure. */
+    template <typename RepT, typename PeriodT, typename ArgsT>
+    timer_id post_event_after(const std::chrono::duration<RepT, PeriodT>& delay, const UserEventT type, ArgsT&& args) noexcept {
+        return post_event_at(clock_type::now() + std::chrono::ceil<clock_type::duration>(delay),
+                             type, std::forward<ArgsT>(args));
+    }
+
+    template <typename RepT, typename PeriodT>
+    timer_id post_event_after(const std::chrono::duration<RepT, PeriodT>& delay, const UserEventT type) noexcept {
+        return post_event_at(clock_type::now() + std::chrono::ceil<clock_type::duration>(delay), type);
+    }
+
+    template <typename ArgsT>
+    timer_id post_event_at(const clock_type::time_point deadline, const UserEventT type, ArgsT&& args) noexcept {
+        try {
+            return add_timer(deadline, clock_type::duration::zero(), type,
+                             std::make_any<std::decay_t<ArgsT>>(std::forward<ArgsT>(args)));
+        } catch (...) {
+            return 0;
+        }
+    }
+
+    timer_id post_event_at(const clock_type::time_point deadline, const UserEventT type) noexcept {
+        return add_timer(deadline, clock_type::duration::zero(), type, std::any {});
+    }
+
+    /** Posts the event every period, the first one after a period. The args are copied each time. */
+    template <typename RepT, typename PeriodT, typename ArgsT>
+    timer_id post_event_every(const std::chrono::duration<RepT, PeriodT>& period, const UserEventT type, ArgsT&& args) noexcept {
+        const auto interval = std::max(std::chrono::ceil<clock_type::duration>(period), clock_type::duration { 1 });
+        try {
+            return add_timer(clock_type::now() + interval, interval, type,
+                             std::make_any<std::decay_t<ArgsT>>(std::forward<ArgsT>(args)));
+        } catch (...) {
+            return 0;
+        }
+    }
+
+    template <typename RepT, typename PeriodT>
+    timer_id post_event_every(const std::chrono::duration<RepT, PeriodT>& period, const UserEventT type) noexcept {
+        const auto interval = std::max(std::chrono::ceil<clock_type::duration>(period), clock_type::duration { 1 });
+        return add_timer(clock_type::now() + interval, interval, type, std::any {});
+    }
+
+    /** Returns false if the timer has already fired (one-shot) or been cancelled. */
+    bool cancel_timer(const timer_id id) noexcept {
+        std::lock_guard<std::mutex> lck { m_timer_mutex };
+        return m_timers.erase(id) != 0;
     }
 };
 
@@ -0,0 +1,420 @@
+﻿// -*- coding: utf-8-with-signature-dos -*-
+// vim:fileencoding=utf-8:ff=dos
+//
+// An event loop toolbox with multiple worker threads.
+
+#ifndef EVENT_LOOP_POOL_HPP_INCLUDED
+#define EVENT_LOOP_POOL_HPP_INCLUDED
+
+// C++ standard library
+#include <algorithm>
+#include <any>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// C++ user library
+#include "event_loop.hpp"
+
+/* ---------------------------------------------------------------------- */
+/*  */
+/* ---------------------------------------------------------------------- */
+
+namespace cun {
+
+inline namespace event_loop_pool {
+
+/**
+ * Event loop toolbox class with multiple worker threads.
+ *
+ * All workers share the same event_entry, so handlers (and the context
+ * object) must be thread-safe. Events posted with a key are always handled
+ * by the worker selected by std::hash of the key, so the events with the
+ * same key are handled in order while unrelated events run in parallel.
+ *
+ * Events posted without a key are scheduled by work stealing: each worker
+ * owns a deque, pops its own events from the bottom and steals the events
+ * of the others from the top when it runs out of work. An event posted
+ * from a handler goes to the deque of the calling worker, so follow-up
+ * events stay on the same core unless another worker is idle. Events
+ * posted from other threads go to a shared injection queue.
+ *
+ * A handler must not call send_event of its own pool: every worker may end
+ * up waiting for another one.
+ */
+template <
+    typename UserEventT,
+    ContextPtr ContextPtrT = void *,
+    RVTraits RVTraitsT = ReturnTraits<bool>
+>
+class EventLoopPool {
+public:
+    using return_type = typename RVTraitsT::type;
+    using event_proc = std::function<return_type (ContextPtrT, std::any&, std::any&)>;
+    using event_entry = std::map<UserEventT, event_proc>;
+    using size_type = std::size_t;
+
+private:
+    using completion_type = CompletionSlot<return_type>;
+    using mail_type = std::tuple<UserEventT, completion_type *, std::any, std::any>;
+
+    static constexpr size_type CACHE_LINE_SIZE { 64 };
+
+    struct alignas(CACHE_LINE_SIZE) Worker final {
+        const EventLoopPool *owner { nullptr };
+        size_type index { 0 };
+
+        // Guards pinned and local.
+        std::mutex mutex;
+        std::deque<mail_type> pinned;
+        std::deque<mail_type> local;
+
+        // Guarded by EventLoopPool::m_mutex.
+        std::condition_variable cond;
+        bool idle { false };
+
+        std::thread thread;
+    };
+
+    ContextPtrT m_context;
+    event_entry m_event_entry;
+    std::mutex m_mutex;
+    std::deque<mail_type> m_mails;
+    std::atomic_bool m_closed { false };
+    std::atomic<size_type> m_num_idle { 0 };
+    size_type m_num_workers;
+    std::unique_ptr<Worker[]> m_workers;
+
+    static size_type workers_or_default(const size_type num_workers) noexcept {
+        return (num_workers != 0) ? num_workers : std::max(1U, std::thread::hardware_concurrency());
+    }
+
+    static Worker *& current_worker() noexcept {
+        static thread_local Worker *worker { nullptr };
+        return worker;
+    }
+
+    void start() {
+        for (size_type i = 0; i < m_num_workers; i++) {
+            auto& worker = m_workers[i];
+            worker.owner = this;
+            worker.index = i;
+            worker.thread = std::thread { [this, &worker]{ main_loop(worker); } };
+        }
+    }
+
+    static bool take_own(Worker& self, mail_type& mail) {
+        std::lock_guard<std::mutex> lck(self.mutex);
+        // Keyed mails first: nobody else can handle them.
+        if (!self.pinned.empty()) {
+            mail = std::move(self.pinned.front());
+            self.pinned.pop_front();
+            return true;
+        }
+        if (!self.local.empty()) {
+            mail = std::move(self.local.back());
+            self.local.pop_back();
+            return true;
+        }
+        return false;
+    }
+
+    bool steal(const Worker& self, mail_type& mail) {
+        for (size_type i = 1; i < m_num_workers; i++) {
+            auto& victim = m_workers[(self.index + i) % m_num_workers];
+            std::lock_guard<std::mutex> lck(victim.mutex);
+            if (!victim.local.empty()) {
+                mail = std::move(victim.local.front());
+                victim.local.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /** Wakes up an idle worker (preferably target). Must be called with m_mutex held. */
+    std::condition_variable *wake_idle(Worker *target) noexcept {
+        if ((target == nullptr) || !target->idle) {
+            target = nullptr;
+            for (size_type i = 0; i < m_num_workers; i++) {
+                if (m_workers[i].idle) {
+                    target = &m_workers[i];
+                    break;
+                }
+            }
+        }
+        if (target == nullptr) {
+            return nullptr;
+        }
+        // Never wake up the same worker twice for two mails.
+        target->idle = false;
+        m_num_idle.fetch_sub(1, std::memory_order_relaxed);
+        return &target->cond;
+    }
+
+    bool next_mail(Worker& self, mail_type& mail) {
+        for (;;) {
+            if (take_own(self, mail) || steal(self, mail)) {
+                return true;
+            }
+
+            std::unique_lock<std::mutex> lck(m_mutex);
+            if (!m_mails.empty()) {
+                mail = std::move(m_mails.front());
+                m_mails.pop_front();
+                return true;
+            }
+
+            // Announce that we are going to sleep, then look around again:
+            // a worker pushing to its local deque checks m_num_idle after that.
+            self.idle = true;
+            m_num_idle.fetch_add(1, std::memory_order_relaxed);
+            const auto found = take_own(self, mail) || steal(self, mail);
+            if (found || m_closed) {
+                self.idle = false;
+                m_num_idle.fetch_sub(1, std::memory_order_relaxed);
+                return found;
+            }
+            self.cond.wait(lck);
+            if (self.idle) {
+                // Spurious wakeup.
+                self.idle = false;
+                m_num_idle.fetch_sub(1, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void main_loop(Worker& self) noexcept {
+        using std::get;
+
+        current_worker() = &self;
+
+        mail_type mail;
+
+        // No mail is returned only after the pool is closed and drained.
+        while (next_mail(self, mail)) {
+            const auto request = get<0>(mail);
+
+            auto retval = RVTraitsT::event_not_found();
+            auto p = m_event_entry.find(request);
+            if (p != m_event_entry.end()) {
+                retval = p->second(m_context, get<2>(mail), get<3>(mail));
+            }
+
+            if (auto *completion = get<1>(mail); completion != nullptr) {
+                completion->set_value(retval);
+            }
+
+            mail = mail_type {};
+        }
+    }
+
+    bool enqueue_local(Worker& self, mail_type&& mail) {
+        // Only the owner thread pushes to its local deque, and it is not
+        // waiting for mails now, so the deque is drained before it exits.
+        if (m_closed) {
+            return false;
+        }
+        {
+            std::lock_guard<std::mutex> lck(self.mutex);
+            self.local.push_back(std::move(mail));
+        }
+        // A worker going to sleep counts itself before it looks at our deque
+        // under the same mutex, so either it sees the mail or we see it.
+        if (m_num_idle.load(std::memory_order_relaxed) == 0) {
+            return true;
+        }
+        std::condition_variable *cond;
+        {
+            std::lock_guard<std::mutex> lck(m_mutex);
+            cond = wake_idle(nullptr);
+        }
+        if (cond != nullptr) {
+            cond->notify_one();
+        }
+        return true;
+    }
+
+    bool enqueue(Worker *target, mail_type&& mail) {
+        if (target == nullptr) {
+            auto *self = current_worker();
+            if ((self != nullptr) && (self->owner == this)) {
+                return enqueue_local(*self, std::move(mail));
+            }
+        }
+
+        std::condition_variable *cond;
+        {
+            std::lock_guard<std::mutex> lck(m_mutex);
+            if (m_closed) {
+                return false;
+            }
+            if (target != nullptr) {
+                {
+                    std::lock_guard<std::mutex> lck_target(target->mutex);
+                    target->pinned.push_back(std::move(mail));
+                }
+                cond = target->idle ? wake_idle(target) : nullptr;
+            } else {
+                m_mails.push_back(std::move(mail));
+                cond = wake_idle(nullptr);
+            }
+        }
+        if (cond != nullptr) {
+            cond->notify_one();
+        }
+        return true;
+    }
+
+    template <typename KeyT>
+    Worker *worker_of(const KeyT& key) const {
+        return &m_workers[std::hash<KeyT> {}(key) % m_num_workers];
+    }
+
+    return_type send_mail(Worker *worker, const UserEventT type, std::any&& args, std::any&& results) noexcept {
+        try {
+            completion_type completion;
+            auto mail = std::make_tuple(type, &completion,
+                                        std::move(args), std::move(results));
+            if (!enqueue(worker, std::move(mail))) {
+                return RVTraitsT::ng();
+            }
+            return completion.wait();
+        } catch (...) {
+            return RVTraitsT::ng();
+        }
+    }
+
+    return_type post_mail(Worker *worker, const UserEventT type, std::any&& args) noexcept {
+        try {
+            auto mail = std::make_tuple(type, static_cast<completion_type *>(nullptr),
+                                        std::move(args), std::any {});
+            if (!enqueue(worker, std::move(mail))) {
+                return RVTraitsT::ng();
+            }
+            return RVTraitsT::ok();
+        } catch (...) {
+            return RVTraitsT::ng();
+        }
+    }
+
+public:
+    /** If num_workers is 0, std::thread::hardware_concurrency() workers are started. */
+    explicit EventLoopPool(const size_type num_workers,
+                           event_entry&& event_entry = {},
+                           ContextPtrT context = nullptr) :
+            m_context { context },
+            m_event_entry { std::move(event_entry) },
+            m_num_workers { workers_or_default(num_workers) },
+            m_workers { std::make_unique<Worker[]>(m_num_workers) } {
+        start();
+    }
+
+    EventLoopPool(const size_type num_workers,
+                  const event_entry& event_entry,
+                  ContextPtrT context = nullptr) :
+            m_context { context },
+            m_event_entry { event_entry },
+            m_num_workers { workers_or_default(num_workers) },
+            m_workers { std::make_unique<Worker[]>(m_num_workers) } {
+        start();
+    }
+
+    virtual ~EventLoopPool() {
+        {
+            std::lock_guard<std::mutex> lck(m_mutex);
+            m_closed = true;
+            while (wake_idle(nullptr) != nullptr) {
+                /*EMPTY*/
+            }
+        }
+        for (size_type i = 0; i < m_num_workers; i++) {
+            m_workers[i].cond.notify_one();
+        }
+        for (size_type i = 0; i < m_num_workers; i++) {
+            m_workers[i].thread.join();
+        }
+    }
+
+    EventLoopPool(const EventLoopPool&) = delete;
+    EventLoopPool(EventLoopPool&&) = delete;
+    EventLoopPool& operator=(const EventLoopPool&) = delete;
+    EventLoopPool& operator=(EventLoopPool&&) = delete;
+
+    size_type num_workers() const noexcept {
+        return m_num_workers;
+    }
+
+    template <typename ArgsT, typename ResultsT>
+    return_type send_event(const UserEventT type, ArgsT&& args, ResultsT&& results) noexcept {
+        return send_mail(nullptr, type,
+                         std::make_any<std::decay_t<ArgsT>>(std::forward<ArgsT>(args)),
+                         std::make_any<std::decay_t<ResultsT>>(std::forward<ResultsT>(results)));
+    }
+
+    template <typename ArgsT>
+    return_type send_event(const UserEventT type, ArgsT&& args) noexcept {
+        return send_mail(nullptr, type,
+                         std::make_any<std::decay_t<ArgsT>>(std::forward<ArgsT>(args)),
+                         std::any {});
+    }
+
+    return_type send_event(const UserEventT type) noexcept {
+        return send_mail(nullptr, type, std::any {}, std::any {});
+    }
+
+    template <typename KeyT, typename ArgsT, typename ResultsT>
+    return_type send_event_by_key(const KeyT& key, const UserEventT type, ArgsT&& args, ResultsT&& results) noexcept {
+        return send_mail(worker_of(key), type,
+                         std::make_any<std::decay_t<ArgsT>>(std::forward<ArgsT>(args)),
+                         std::make_any<std::decay_t<ResultsT>>(std::forward<ResultsT>(results)));
+    }
+
+    template <typename KeyT, typename ArgsT>
+    return_type send_event_by_key(const KeyT& key, const UserEventT type, ArgsT&& args) noexcept {
+        return send_mail(worker_of(key), type,
+                         std::make_any<std::decay_t<ArgsT>>(std::forward<ArgsT>(args)),
+                         std::any {});
+    }
+
+    template <typename KeyT>
+    return_type send_event_by_key(const KeyT& key, const UserEventT type) noexcept {
+        return send_mail(worker_of(key), type, std::any {}, std::any {});
+    }
+
+    template <typename ArgsT>
+    return_type post_event(const UserEventT type, ArgsT&& args) noexcept {
+        return post_mail(nullptr, type,
+                         std::make_any<std::decay_t<ArgsT>>(std::forward<ArgsT>(args)));
+    }
+
+    return_type post_event(const UserEventT type) noexcept {
+        return post_mail(nullptr, type, std::any {});
+    }
+
+    template <typename KeyT, typename ArgsT>
+    return_type post_event_by_key(const KeyT& key, const UserEventT type, ArgsT&& args) noexcept {
+        return post_mail(worker_of(key), type,
+                         std::make_any<std::decay_t<ArgsT>>(std::forward<ArgsT>(args)));
+    }
+
+    template <typename KeyT>
+    return_type post_event_by_key(const KeyT& key, const UserEventT type) noexcept {
+        return post_mail(worker_of(key), type, std::any {});
+    }
+};
+
+} // inline namespace event_loop_pool
+
+} // namespace cun
+
+#endif // ndef EVENT_LOOP_POOL_HPP_INCLUDED
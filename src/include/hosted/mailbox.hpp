@@ -7,10 +7,22 @@
 #define CUN_MAILBOX_HPP_INCLUDED
 
 // C++ standard library
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
 #include <chrono>
+#include <cmath>
+#include <concepts>
 #include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
 #include <mutex>
+#include <optional>
 #include <queue>
+#include <span>
+#include <type_traits>
 #include <utility>
 
 /* ---------------------------------------------------------------------- */
@@ -21,23 +33,366 @@ namespace cun {
 
 inline namespace mailbox {
 
-/** Inter-thread communication mailbox class. */
-template <typename T>
+/** A snapshot of mailbox statistics. */
+struct MailboxStats final {
+    using duration = std::chrono::nanoseconds;
+
+    /** Bucket 0 counts latencies under 1us, bucket i counts [2^(i-1), 2^i) us. */
+    static constexpr std::size_t NUM_LATENCY_BUCKETS { 32 };
+
+    std::uint64_t num_pushed;
+    std::uint64_t num_popped;
+    std::size_t max_depth;
+
+    /** Enqueue-to-dequeue latency. */
+    duration latency_min;
+    duration latency_max;
+    duration latency_mean;
+    duration latency_stdev;
+    std::uint64_t latency_histogram[NUM_LATENCY_BUCKETS];
+
+    /** Time spent waiting for the mutex. */
+    duration lock_wait_total;
+    duration lock_wait_max;
+
+    /** Wake-ups of blocked pops, and those which found nothing to pop. */
+    std::uint64_t num_wakeups;
+    std::uint64_t num_spurious_wakeups;
+};
+
+/** Inter-thread communication mailbox class.
+ *
+ * After close(), pushes are rejected and pops return false once the
+ * remaining mails have been drained. If ENABLE_STATS is true, the mailbox
+ * records MailboxStats; otherwise the statistics are compiled out.
+ *
+ * If CAPACITY is not 0, the mails are stored in a preallocated ring of
+ * CAPACITY elements instead of std::queue, so that push and pop never
+ * allocate. In this mode push blocks while the mailbox is full.
+ *
+ * Otherwise the *_bounded operations limit the mailbox to a size given per
+ * push, so that producers can choose how to handle a full mailbox.
+ */
+template <typename T, bool ENABLE_STATS = false, std::size_t CAPACITY = 0>
+requires (CAPACITY == 0) || std::default_initializable<T>
 class Mailbox final {
+private:
+    /** A fixed capacity FIFO queue with the subset of std::queue interface we use. */
+    template <typename U>
+    class FixedQueue final {
+    public:
+        using size_type = std::size_t;
+
+    private:
+        std::array<U, CAPACITY> m_buf {};
+        size_type m_head { 0 };
+        size_type m_size { 0 };
+
+    public:
+        void clear() {
+            while (!empty()) {
+                pop();
+            }
+            m_head = 0;
+        }
+
+        bool empty() const noexcept {
+            return m_size == 0;
+        }
+
+        template <typename... Args>
+        void emplace(Args&& ... args) {
+            auto tail = m_head + m_size;
+            if (tail >= CAPACITY) {
+                tail -= CAPACITY;
+            }
+            m_buf[tail] = U(std::forward<Args>(args) ...);
+            m_size++;
+        }
+
+        U& front() noexcept {
+            return m_buf[m_head];
+        }
+
+        bool full() const noexcept {
+            return m_size == CAPACITY;
+        }
+
+        void pop() {
+            m_buf[m_head] = U {};
+            if (++m_head == CAPACITY) {
+                m_head = 0;
+            }
+            m_size--;
+        }
+
+        void push(const U& val) {
+            emplace(val);
+        }
+
+        void push(U&& val) {
+            emplace(std::move(val));
+        }
+
+        size_type size() const noexcept {
+            return m_size;
+        }
+    };
+
+    /** std::queue exposing its container, to find mails in the middle. */
+    template <typename U>
+    class DequeQueue final : public std::queue<U> {
+    public:
+        using std::queue<U>::c;
+    };
+
+    template <typename U>
+    using queue_type = std::conditional_t<CAPACITY == 0, DequeQueue<U>, FixedQueue<U>>;
+
 public:
-    using size_type = typename std::queue<T>::size_type;
+    using size_type = typename queue_type<T>::size_type;
     using value_type = T;
 
 private:
+    using clock = std::chrono::steady_clock;
+
+    struct Stats final {
+        MailboxStats snapshot {};
+        double latency_sum { 0.0 };
+        double latency_square_sum { 0.0 };
+        queue_type<clock::time_point> stamps;
+    };
+
+    struct NoStats final {};
+
     mutable std::mutex m_mutex;
     std::condition_variable m_cond;
-    std::queue<value_type> m_queue;
+    std::condition_variable m_cond_push;
+    std::atomic_size_t m_num_bounded_waiters { 0 }; // Producers in push_bounded, which wait with their own limits.
+    queue_type<value_type> m_queue;
+    bool m_closed { false };
+    [[no_unique_address]] mutable std::conditional_t<ENABLE_STATS, Stats, NoStats> m_stats;
+
+    bool ready() const noexcept {
+        return !m_queue.empty() || m_closed;
+    }
+
+    bool writable(std::unique_lock<std::mutex>& lck) {
+        if constexpr (CAPACITY != 0) {
+            m_cond_push.wait(lck, [this]{ return !m_queue.full() || m_closed; });
+        }
+        return !m_closed;
+    }
+
+    template <typename Q>
+    static void clear_queue(Q& q) {
+        if constexpr (CAPACITY == 0) {
+            Q empty;
+            std::swap(q, empty);
+        } else {
+            q.clear();
+        }
+    }
+
+    std::unique_lock<std::mutex> lock() const {
+        if constexpr (ENABLE_STATS) {
+            const auto begin = clock::now();
+            std::unique_lock<std::mutex> lck(m_mutex);
+            const auto wait = clock::now() - begin;
+            m_stats.snapshot.lock_wait_total += wait;
+            m_stats.snapshot.lock_wait_max = std::max<MailboxStats::duration>(m_stats.snapshot.lock_wait_max, wait);
+            return lck;
+        } else {
+            return std::unique_lock<std::mutex>(m_mutex);
+        }
+    }
+
+    auto ready_predicate() {
+        return [this, first = true]() mutable {
+            const auto r = ready();
+            if constexpr (ENABLE_STATS) {
+                if (!first) {
+                    m_stats.snapshot.num_wakeups++;
+                    if (!r) {
+                        m_stats.snapshot.num_spurious_wakeups++;
+                    }
+                }
+                first = false;
+            }
+            return r;
+        };
+    }
+
+    // Counts only the returns from the wait, not the last check on the timeout.
+    template <typename RepT, typename PeriodT>
+    void wait_ready(std::unique_lock<std::mutex>& lck, const std::chrono::duration<RepT, PeriodT>& timeout) {
+        if constexpr (ENABLE_STATS) {
+            const auto deadline = clock::now() + std::chrono::ceil<clock::duration>(timeout);
+            if (ready()) {
+                return;
+            }
+            while (m_cond.wait_until(lck, deadline) == std::cv_status::no_timeout) {
+                m_stats.snapshot.num_wakeups++;
+                if (ready()) {
+                    return;
+                }
+                m_stats.snapshot.num_spurious_wakeups++;
+            }
+        } else {
+            m_cond.wait_for(lck, timeout, [this]{ return ready(); });
+        }
+    }
+
+    void record_push(const size_type n) {
+        if constexpr (ENABLE_STATS) {
+            const auto now = clock::now();
+            for (size_type i = 0; i < n; i++) {
+                m_stats.stamps.push(now);
+            }
+            m_stats.snapshot.num_pushed += n;
+            m_stats.snapshot.max_depth = std::max<std::size_t>(m_stats.snapshot.max_depth, m_queue.size());
+        }
+    }
+
+    void record_pop() noexcept {
+        if constexpr (ENABLE_STATS) {
+            auto& snapshot = m_stats.snapshot;
+            const auto latency = std::chrono::duration_cast<MailboxStats::duration>(clock::now() - m_stats.stamps.front());
+            m_stats.stamps.pop();
+
+            if (snapshot.num_popped == 0) {
+                snapshot.latency_min = latency;
+                snapshot.latency_max = latency;
+            } else {
+                snapshot.latency_min = std::min(snapshot.latency_min, latency);
+                snapshot.latency_max = std::max(snapshot.latency_max, latency);
+            }
+            snapshot.num_popped++;
+
+            const auto ns = static_cast<double>(latency.count());
+            m_stats.latency_sum += ns;
+            m_stats.latency_square_sum += ns * ns;
+
+            const auto us = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(latency).count());
+            const auto bucket = std::min<std::size_t>(std::bit_width(us), MailboxStats::NUM_LATENCY_BUCKETS - 1);
+            snapshot.latency_histogram[bucket]++;
+        }
+    }
+
+    void dequeue(value_type& val) {
+        val = std::move(m_queue.front());
+        m_queue.pop();
+        record_pop();
+    }
+
+    template <typename OutputIt>
+    size_type move_to(OutputIt& out, const size_type max) {
+        size_type n { 0 };
+        for (; (n < max) && !m_queue.empty(); n++) {
+            *out = std::move(m_queue.front());
+            ++out;
+            m_queue.pop();
+            record_pop();
+        }
+        return n;
+    }
+
+    void notify(const size_type n) noexcept {
+        if (n == 1) {
+            m_cond.notify_one();
+        } else if (n > 1) {
+            m_cond.notify_all();
+        }
+    }
+
+    // Also wakes the producers blocked in push_bounded. They wait with
+    // different limits, so one of them may not be the right one to wake.
+    void notify_writable(const size_type n) noexcept {
+        if ((n > 1) || ((n == 1) && (m_num_bounded_waiters != 0))) {
+            m_cond_push.notify_all();
+        } else if (n == 1) {
+            m_cond_push.notify_one();
+        }
+    }
+
+    template <typename PredT>
+    auto find_newest(PredT& pred) {
+        auto& mails = m_queue.c;
+        for (auto p = mails.rbegin(); p != mails.rend(); ++p) {
+            if (pred(std::as_const(*p))) {
+                return std::prev(p.base());
+            }
+        }
+        return mails.end();
+    }
+
+    template <typename PredT>
+    auto find_oldest(PredT& pred) {
+        auto& mails = m_queue.c;
+        for (auto p = mails.begin(); p != mails.end(); ++p) {
+            if (pred(std::as_const(*p))) {
+                return p;
+            }
+        }
+        return mails.end();
+    }
 
 public:
     void clear() {
+        {
+            auto lck = lock();
+            clear_queue(m_queue);
+            if constexpr (ENABLE_STATS) {
+                clear_queue(m_stats.stamps);
+            }
+        }
+        m_cond_push.notify_all();
+    }
+
+    void close() {
+        {
+            auto lck = lock();
+            m_closed = true;
+        }
+        m_cond.notify_all();
+        m_cond_push.notify_all();
+    }
+
+    bool closed() const noexcept {
         std::lock_guard<std::mutex> lck(m_mutex);
-        std::queue<value_type> empty;
-        std::swap(m_queue, empty);
+        return m_closed;
+    }
+
+    template <typename ContainerT>
+    size_type drain(ContainerT& dst) {
+        if constexpr (CAPACITY != 0) {
+            // Moving out the whole ring would not be allocation-free, so move the mails one by one.
+            size_type n;
+            {
+                auto lck = lock();
+                auto out = std::back_inserter(dst);
+                n = move_to(out, CAPACITY);
+            }
+            notify_writable(n);
+            return n;
+        } else {
+            queue_type<value_type> q;
+            {
+                auto lck = lock();
+                std::swap(m_queue, q);
+                if constexpr (ENABLE_STATS) {
+                    while (!m_stats.stamps.empty()) {
+                        record_pop();
+                    }
+                }
+            }
+            const auto n = q.size();
+            for (; !q.empty(); q.pop()) {
+                dst.push_back(std::move(q.front()));
+            }
+            m_cond_push.notify_all();
+            return n;
+        }
     }
 
     bool empty() const noexcept {
@@ -45,48 +400,160 @@ public:
         return m_queue.empty();
     }
 
+    bool full() const noexcept requires (CAPACITY != 0) {
+        std::lock_guard<std::mutex> lck(m_mutex);
+        return m_queue.full();
+    }
+
+    size_type max_size() const noexcept requires (CAPACITY != 0) {
+        return CAPACITY;
+    }
+
     value_type pop() {
-        value_type val;
-        pop(val);
+        value_type val {};
+        (void) pop(val);
         return val;
     }
 
-    void pop(value_type& val) {
-        std::unique_lock<std::mutex> lck(m_mutex);
-        m_cond.wait(lck, [this]{ return !m_queue.empty(); });
-        val = std::move(m_queue.front());
-        m_queue.pop();
+    bool pop(value_type& val) {
+        {
+            auto lck = lock();
+            m_cond.wait(lck, ready_predicate());
+            if (m_queue.empty()) {
+                return false;
+            }
+            dequeue(val);
+        }
+        notify_writable(1);
+        return true;
     }
 
     template <typename RepT, typename PeriodT>
     bool pop(value_type& val, const std::chrono::duration<RepT, PeriodT>& timeout) {
-        std::unique_lock<std::mutex> lck(m_mutex);
-        const auto have_some =
-            m_cond.wait_for(lck, timeout, [this]{ return !m_queue.empty(); });
-        if (have_some) {
-            val = std::move(m_queue.front());
-            m_queue.pop();
+        {
+            auto lck = lock();
+            wait_ready(lck, timeout);
+            if (m_queue.empty()) {
+                return false;
+            }
+            dequeue(val);
         }
-        return have_some;
+        notify_writable(1);
+        return true;
     }
 
-    void push(const value_type& val) {
-        std::lock_guard<std::mutex> lck(m_mutex);
-        m_queue.push(val);
+    template <std::output_iterator<value_type> OutputIt>
+    size_type pop_n(OutputIt out, const size_type max) {
+        if (max == 0) {
+            return 0;
+        }
+        size_type n;
+        {
+            auto lck = lock();
+            m_cond.wait(lck, ready_predicate());
+            n = move_to(out, max);
+        }
+        notify_writable(n);
+        return n;
+    }
+
+    template <std::output_iterator<value_type> OutputIt, typename RepT, typename PeriodT>
+    size_type pop_n(OutputIt out, const size_type max, const std::chrono::duration<RepT, PeriodT>& timeout) {
+        if (max == 0) {
+            return 0;
+        }
+        size_type n;
+        {
+            auto lck = lock();
+            wait_ready(lck, timeout);
+            n = move_to(out, max);
+        }
+        notify_writable(n);
+        return n;
+    }
+
+    bool push(const value_type& val) {
+        {
+            auto lck = lock();
+            if (!writable(lck)) {
+                return false;
+            }
+            m_queue.push(val);
+            record_push(1);
+        }
         m_cond.notify_one();
+        return true;
     }
 
-    void push(value_type&& val) {
-        std::lock_guard<std::mutex> lck(m_mutex);
-        m_queue.push(std::move(val));
+    bool push(value_type&& val) {
+        {
+            auto lck = lock();
+            if (!writable(lck)) {
+                return false;
+            }
+            m_queue.push(std::move(val));
+            record_push(1);
+        }
         m_cond.notify_one();
+        return true;
+    }
+
+    /** Copies vals into the mailbox, as push_range does. */
+    bool push_bulk(std::span<const value_type> vals) {
+        return push_range(vals.begin(), vals.end());
+    }
+
+    /** Moves vals into the mailbox, leaving them in the moved-from state. */
+    bool push_bulk_move(std::span<value_type> vals) {
+        return push_range(std::make_move_iterator(vals.begin()), std::make_move_iterator(vals.end()));
+    }
+
+    /**
+     * In the fixed capacity mode, a range larger than the free space is
+     * pushed in several batches, and false is returned if the mailbox is
+     * closed in between.
+     */
+    template <std::input_iterator InputIt, std::sentinel_for<InputIt> SentinelT>
+    bool push_range(InputIt first, SentinelT last) {
+        size_type n { 0 };
+        try {
+            auto lck = lock();
+            if (m_closed) {
+                return false;
+            }
+            for (; first != last; ++first, ++n) {
+                if constexpr (CAPACITY != 0) {
+                    if (m_queue.full()) {
+                        notify(n);
+                        n = 0;
+                        if (!writable(lck)) {
+                            return false;
+                        }
+                    }
+                }
+                m_queue.emplace(*first);
+                record_push(1);
+            }
+        } catch (...) {
+            notify(n);
+            throw;
+        }
+        notify(n);
+        return true;
     }
 
     template <typename... Args>
-    void emplace(Args&& ... args) {
-        std::lock_guard<std::mutex> lck(m_mutex);
-        m_queue.emplace(std::forward<Args>(args) ...);
+    bool emplace(Args&& ... args) {
+        {
+            auto lck = lock();
+            if (!writable(lck)) {
+                return false;
+            }
+            m_queue.emplace(std::forward<Args>(args) ...);
+            record_push(1);
+        }
         m_cond.notify_one();
+        return true;
     }
 
     size_type size() const noexcept {
@@ -94,17 +561,149 @@ public:
         return m_queue.size();
     }
 
+    MailboxStats stats() const requires ENABLE_STATS {
+        auto lck = lock();
+        auto snapshot = m_stats.snapshot;
+        if (snapshot.num_popped > 0) {
+            const auto n = static_cast<double>(snapshot.num_popped);
+            const auto mean = m_stats.latency_sum / n;
+            const auto variance = std::max(0.0, m_stats.latency_square_sum / n - mean * mean);
+            snapshot.latency_mean = MailboxStats::duration { static_cast<MailboxStats::duration::rep>(mean) };
+            snapshot.latency_stdev = MailboxStats::duration { static_cast<MailboxStats::duration::rep>(std::sqrt(variance)) };
+        }
+        return snapshot;
+    }
+
+    void reset_stats() requires ENABLE_STATS {
+        auto lck = lock();
+        m_stats.snapshot = MailboxStats {};
+        m_stats.snapshot.max_depth = m_queue.size();
+        m_stats.latency_sum = 0.0;
+        m_stats.latency_square_sum = 0.0;
+    }
+
     bool try_pop(value_type& val) {
-        std::lock_guard<std::mutex> lck(m_mutex);
-        if (m_queue.empty()) {
-            return false;
-        };
-        val = std::move(m_queue.front());
-        m_queue.pop();
+        {
+            auto lck = lock();
+            if (m_queue.empty()) {
+                return false;
+            };
+            dequeue(val);
+        }
+        notify_writable(1);
+        return true;
+    }
+
+    /** Blocks while the mailbox holds limit or more mails. */
+    template <typename U>
+    bool push_bounded(U&& val, const size_type limit) requires (CAPACITY == 0) {
+        {
+            auto lck = lock();
+            m_num_bounded_waiters++;
+            m_cond_push.wait(lck, [this, limit]{ return (m_queue.size() < limit) || m_closed; });
+            m_num_bounded_waiters--;
+            if (m_closed) {
+                return false;
+            }
+            m_queue.push(std::forward<U>(val));
+            record_push(1);
+        }
+        m_cond.notify_one();
+        return true;
+    }
+
+    /** Returns false if the mailbox holds limit or more mails. */
+    template <typename U>
+    bool try_push_bounded(U&& val, const size_type limit) requires (CAPACITY == 0) {
+        {
+            auto lck = lock();
+            if (m_closed || (m_queue.size() >= limit)) {
+                return false;
+            }
+            m_queue.push(std::forward<U>(val));
+            record_push(1);
+        }
+        m_cond.notify_one();
+        return true;
+    }
+
+    /**
+     * If the mailbox holds limit or more mails, discards the oldest mail
+     * which satisfies pred before pushing. Returns false if there is none.
+     */
+    template <typename U, typename PredT>
+    bool push_bounded_dropping(U&& val, const size_type limit, PredT pred) requires (CAPACITY == 0) {
+        std::optional<value_type> dropped; // Destroyed after unlocking.
+        {
+            auto lck = lock();
+            if (m_closed) {
+                return false;
+            }
+            if (m_queue.size() >= limit) {
+                const auto p = find_oldest(pred);
+                if (p == m_queue.c.end()) {
+                    return false;
+                }
+                if constexpr (ENABLE_STATS) {
+                    m_stats.stamps.c.erase(m_stats.stamps.c.begin() + (p - m_queue.c.begin()));
+                }
+                dropped.emplace(std::move(*p));
+                m_queue.c.erase(p);
+            }
+            m_queue.push(std::forward<U>(val));
+            record_push(1);
+        }
+        m_cond.notify_one();
+        return true;
+    }
+
+    /**
+     * If the mailbox holds limit or more mails, replaces the newest mail
+     * which satisfies pred with val. Returns false if there is none.
+     */
+    template <typename U, typename PredT>
+    bool push_bounded_replacing(U&& val, const size_type limit, PredT pred) requires (CAPACITY == 0) {
+        std::optional<value_type> replaced; // Destroyed after unlocking.
+        {
+            auto lck = lock();
+            if (m_closed) {
+                return false;
+            }
+            if (m_queue.size() >= limit) {
+                const auto p = find_newest(pred);
+                if (p == m_queue.c.end()) {
+                    return false;
+                }
+                replaced.emplace(std::move(*p));
+                *p = std::forward<U>(val);
+                return true;
+            }
+            m_queue.push(std::forward<U>(val));
+            record_push(1);
+        }
+        m_cond.notify_one();
+        return true;
+    }
+
+    template <typename U>
+    bool try_push(U&& val) requires (CAPACITY != 0) {
+        {
+            auto lck = lock();
+            if (m_closed || m_queue.full()) {
+                return false;
+            }
+            m_queue.push(std::forward<U>(val));
+            record_push(1);
+        }
+        m_cond.notify_one();
         return true;
     }
 };
 
+/** A Mailbox which never allocates after construction. */
+template <typename T, std::size_t N, bool ENABLE_STATS = false>
+using FixedMailbox = Mailbox<T, ENABLE_STATS, N>;
+
 } // inline namespace mailbox
 
 } // namespace cun
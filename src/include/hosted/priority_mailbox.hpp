@@ -0,0 +1,194 @@
+﻿// -*- coding: utf-8-with-signature-dos -*-
+// vim:fileencoding=utf-8:ff=dos
+//
+// An inter-thread communication mailbox with priority ordering.
+
+#ifndef CUN_PRIORITY_MAILBOX_HPP_INCLUDED
+#define CUN_PRIORITY_MAILBOX_HPP_INCLUDED
+
+// C++ standard library
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+/* ---------------------------------------------------------------------- */
+/*  */
+/* ---------------------------------------------------------------------- */
+
+namespace cun {
+
+inline namespace priority_mailbox {
+
+/**
+ * Inter-thread communication mailbox class with priority ordering.
+ *
+ * As with std::priority_queue, the greatest mail in terms of Compare is
+ * popped first. Mails with the same priority are popped in FIFO order.
+ * After close(), pushes are rejected and pops return false once the
+ * remaining mails have been drained.
+ */
+template <typename T, typename Compare = std::less<T>>
+class PriorityMailbox final {
+public:
+    using size_type = typename std::vector<T>::size_type;
+    using value_type = T;
+    using value_compare = Compare;
+
+private:
+    struct Entry final {
+        value_type value;
+        std::uint_fast64_t seq;
+    };
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::vector<Entry> m_heap;
+    std::uint_fast64_t m_seq { 0 };
+    value_compare m_comp;
+    bool m_closed { false };
+
+    bool ready() const noexcept {
+        return !m_heap.empty() || m_closed;
+    }
+
+    bool lower_priority(const Entry& lhs, const Entry& rhs) const {
+        if (m_comp(lhs.value, rhs.value)) {
+            return true;
+        }
+        if (m_comp(rhs.value, lhs.value)) {
+            return false;
+        }
+        return lhs.seq > rhs.seq;
+    }
+
+    template <typename... Args>
+    void enqueue(Args&& ... args) {
+        m_heap.push_back(Entry { value_type(std::forward<Args>(args) ...), m_seq++ });
+        std::push_heap(m_heap.begin(), m_heap.end(),
+                       [this](const Entry& lhs, const Entry& rhs) { return lower_priority(lhs, rhs); });
+    }
+
+    void dequeue(value_type& val) {
+        std::pop_heap(m_heap.begin(), m_heap.end(),
+                      [this](const Entry& lhs, const Entry& rhs) { return lower_priority(lhs, rhs); });
+        val = std::move(m_heap.back().value);
+        m_heap.pop_back();
+    }
+
+public:
+    PriorityMailbox() = default;
+
+    explicit PriorityMailbox(const value_compare& comp) : m_comp { comp } {}
+
+    void clear() {
+        std::lock_guard<std::mutex> lck(m_mutex);
+        m_heap.clear();
+    }
+
+    void close() {
+        {
+            std::lock_guard<std::mutex> lck(m_mutex);
+            m_closed = true;
+        }
+        m_cond.notify_all();
+    }
+
+    bool closed() const noexcept {
+        std::lock_guard<std::mutex> lck(m_mutex);
+        return m_closed;
+    }
+
+    bool empty() const noexcept {
+        std::lock_guard<std::mutex> lck(m_mutex);
+        return m_heap.empty();
+    }
+
+    value_type pop() {
+        value_type val {};
+        (void) pop(val);
+        return val;
+    }
+
+    bool pop(value_type& val) {
+        std::unique_lock<std::mutex> lck(m_mutex);
+        m_cond.wait(lck, [this]{ return ready(); });
+        if (m_heap.empty()) {
+            return false;
+        }
+        dequeue(val);
+        return true;
+    }
+
+    template <typename RepT, typename PeriodT>
+    bool pop(value_type& val, const std::chrono::duration<RepT, PeriodT>& timeout) {
+        std::unique_lock<std::mutex> lck(m_mutex);
+        m_cond.wait_for(lck, timeout, [this]{ return ready(); });
+        if (m_heap.empty()) {
+            return false;
+        }
+        dequeue(val);
+        return true;
+    }
+
+    bool push(const value_type& val) {
+        {
+            std::lock_guard<std::mutex> lck(m_mutex);
+            if (m_closed) {
+                return false;
+            }
+            enqueue(val);
+        }
+        m_cond.notify_one();
+        return true;
+    }
+
+    bool push(value_type&& val) {
+        {
+            std::lock_guard<std::mutex> lck(m_mutex);
+            if (m_closed) {
+                return false;
+            }
+            enqueue(std::move(val));
+        }
+        m_cond.notify_one();
+        return true;
+    }
+
+    template <typename... Args>
+    bool emplace(Args&& ... args) {
+        {
+            std::lock_guard<std::mutex> lck(m_mutex);
+            if (m_closed) {
+                return false;
+            }
+            enqueue(std::forward<Args>(args) ...);
+        }
+        m_cond.notify_one();
+        return true;
+    }
+
+    size_type size() const noexcept {
+        std::lock_guard<std::mutex> lck(m_mutex);
+        return m_heap.size();
+    }
+
+    bool try_pop(value_type& val) {
+        std::lock_guard<std::mutex> lck(m_mutex);
+        if (m_heap.empty()) {
+            return false;
+        }
+        dequeue(val);
+        return true;
+    }
+};
+
+} // inline namespace priority_mailbox
+
+} // namespace cun
+
+#endif // ndef CUN_PRIORITY_MAILBOX_HPP_INCLUDED
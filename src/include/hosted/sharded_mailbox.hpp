@@ -0,0 +1,321 @@
+﻿// -*- coding: utf-8-with-signature-dos -*-
+// vim:fileencoding=utf-8:ff=dos
+//
+// A sharded inter-thread communication mailbox (MPSC).
+
+#ifndef CUN_SHARDED_MAILBOX_HPP_INCLUDED
+#define CUN_SHARDED_MAILBOX_HPP_INCLUDED
+
+// C++ standard library
+#include <atomic>
+#include <chrono>
+#include <concepts>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <utility>
+
+// C++ user library
+#include "circular_buffer.hpp"
+
+/* ---------------------------------------------------------------------- */
+/*  */
+/* ---------------------------------------------------------------------- */
+
+namespace cun {
+
+inline namespace sharded_mailbox {
+
+/**
+ * Sharded inter-thread communication mailbox class (MPSC).
+ *
+ * Each registered producer owns one SPSC lane (CircularBuffer) and the
+ * single consumer visits the lanes in round-robin order, so producers
+ * never share a write index. A Producer handle must be used by one
+ * thread at a time, and only one thread may pop.
+ */
+template <typename T, std::size_t N, std::size_t MAX_PRODUCERS = 16>
+requires std::default_initializable<T>
+class ShardedMailbox final {
+    static_assert(MAX_PRODUCERS > 0, "ShardedMailbox: 0 producer is not allowed.");
+
+public:
+    using size_type = std::size_t;
+    using value_type = T;
+
+    /** A registration handle of a producer. */
+    class Producer final {
+    private:
+        friend class ShardedMailbox;
+
+        ShardedMailbox *m_owner { nullptr };
+        size_type m_index { 0 };
+
+        Producer(ShardedMailbox *owner, const size_type index) noexcept :
+            m_owner { owner }, m_index { index } {}
+
+    public:
+        Producer() noexcept = default;
+
+        ~Producer() {
+            release();
+        }
+
+        Producer(const Producer&) = delete;
+        Producer& operator=(const Producer&) = delete;
+
+        Producer(Producer&& other) noexcept :
+            m_owner { std::exchange(other.m_owner, nullptr) },
+            m_index { other.m_index } {}
+
+        Producer& operator=(Producer&& other) noexcept {
+            if (this != &other) {
+                release();
+                m_owner = std::exchange(other.m_owner, nullptr);
+                m_index = other.m_index;
+            }
+            return *this;
+        }
+
+        explicit operator bool() const noexcept {
+            return m_owner != nullptr;
+        }
+
+        bool push(const value_type& val) {
+            return (m_owner != nullptr) && m_owner->push_to(m_index, val);
+        }
+
+        void release() noexcept {
+            if (m_owner != nullptr) {
+                m_owner->retire(m_index);
+                m_owner = nullptr;
+            }
+        }
+
+        bool try_push(const value_type& val) {
+            return (m_owner != nullptr) && m_owner->try_push_to(m_index, val);
+        }
+    };
+
+private:
+    static constexpr size_type CACHE_LINE_SIZE { 64 };
+
+    enum class LaneState {
+        free,
+        active,
+        retired
+    };
+
+    struct alignas(CACHE_LINE_SIZE) Lane final {
+        std::atomic<LaneState> state { LaneState::free };
+        CircularBuffer<value_type, N> buffer;
+    };
+
+    Lane m_lanes[MAX_PRODUCERS];
+    size_type m_next_lane { 0 };
+
+    std::atomic_bool m_closed { false };
+    std::atomic_uint m_num_pop_waiters { 0 };
+    std::atomic_uint m_num_push_waiters { 0 };
+    std::mutex m_mutex;
+    std::condition_variable m_cond_pop;
+    std::condition_variable m_cond_push;
+
+    bool is_closed() const noexcept {
+        return m_closed.load(std::memory_order_seq_cst);
+    }
+
+    bool readable() const noexcept {
+        for (const auto& lane : m_lanes) {
+            if ((lane.state.load(std::memory_order_acquire) != LaneState::free) && !lane.buffer.empty()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void wake(std::atomic_uint& num_waiters, std::condition_variable& cond) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (num_waiters.load(std::memory_order_relaxed) == 0) {
+            return;
+        }
+        // Synchronize with a waiter between its predicate check and its sleep.
+        { std::lock_guard<std::mutex> lck(m_mutex); }
+        cond.notify_all();
+    }
+
+    template <typename PredT>
+    void park(std::atomic_uint& num_waiters, std::condition_variable& cond, PredT pred) {
+        num_waiters.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        {
+            std::unique_lock<std::mutex> lck(m_mutex);
+            cond.wait(lck, pred);
+        }
+        num_waiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    template <typename PredT, typename ClockT, typename DurationT>
+    bool park_until(std::atomic_uint& num_waiters, std::condition_variable& cond, PredT pred,
+                    const std::chrono::time_point<ClockT, DurationT>& abs_time) {
+        num_waiters.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        bool ready;
+        {
+            std::unique_lock<std::mutex> lck(m_mutex);
+            ready = cond.wait_until(lck, abs_time, pred);
+        }
+        num_waiters.fetch_sub(1, std::memory_order_relaxed);
+        return ready;
+    }
+
+    bool push_to(const size_type index, const value_type& val) {
+        auto& buffer = m_lanes[index].buffer;
+
+        if (is_closed()) {
+            return false;
+        }
+        while (!buffer.push(val)) {
+            park(m_num_push_waiters, m_cond_push, [this, &buffer]{ return !buffer.full() || is_closed(); });
+            if (is_closed()) {
+                return false;
+            }
+        }
+        wake(m_num_pop_waiters, m_cond_pop);
+        return true;
+    }
+
+    bool try_push_to(const size_type index, const value_type& val) {
+        if (is_closed() || !m_lanes[index].buffer.push(val)) {
+            return false;
+        }
+        wake(m_num_pop_waiters, m_cond_pop);
+        return true;
+    }
+
+    void retire(const size_type index) noexcept {
+        m_lanes[index].state.store(LaneState::retired, std::memory_order_release);
+    }
+
+    bool dequeue(value_type& val) {
+        for (size_type i = 0; i < MAX_PRODUCERS; i++) {
+            const auto index = (m_next_lane + i) % MAX_PRODUCERS;
+            auto& lane = m_lanes[index];
+
+            const auto state = lane.state.load(std::memory_order_acquire);
+            if (state == LaneState::free) {
+                continue;
+            }
+            if (lane.buffer.pop(val)) {
+                m_next_lane = (index + 1) % MAX_PRODUCERS;
+                return true;
+            }
+            if (state == LaneState::retired) {
+                // The producer is gone and its lane is drained: recycle it.
+                auto expected = LaneState::retired;
+                (void) lane.state.compare_exchange_strong(expected, LaneState::free, std::memory_order_acq_rel);
+            }
+        }
+        return false;
+    }
+
+public:
+    ShardedMailbox() = default;
+
+    ShardedMailbox(const ShardedMailbox&) = delete;
+    ShardedMailbox(ShardedMailbox&&) = delete;
+    ShardedMailbox& operator=(const ShardedMailbox&) = delete;
+    ShardedMailbox& operator=(ShardedMailbox&&) = delete;
+
+    void close() {
+        m_closed.store(true, std::memory_order_seq_cst);
+        { std::lock_guard<std::mutex> lck(m_mutex); }
+        m_cond_pop.notify_all();
+        m_cond_push.notify_all();
+    }
+
+    bool closed() const noexcept {
+        return is_closed();
+    }
+
+    bool empty() const noexcept {
+        return size() == 0;
+    }
+
+    size_type max_producers() const noexcept {
+        return MAX_PRODUCERS;
+    }
+
+    value_type pop() {
+        value_type val {};
+        (void) pop(val);
+        return val;
+    }
+
+    bool pop(value_type& val) {
+        while (!dequeue(val)) {
+            if (is_closed()) {
+                if (!dequeue(val)) {
+                    return false;
+                }
+                break;
+            }
+            park(m_num_pop_waiters, m_cond_pop, [this]{ return readable() || is_closed(); });
+        }
+        wake(m_num_push_waiters, m_cond_push);
+        return true;
+    }
+
+    template <typename RepT, typename PeriodT>
+    bool pop(value_type& val, const std::chrono::duration<RepT, PeriodT>& timeout) {
+        const auto abs_time = std::chrono::steady_clock::now() + timeout;
+
+        while (!dequeue(val)) {
+            if (is_closed()) {
+                if (!dequeue(val)) {
+                    return false;
+                }
+                break;
+            }
+            if (!park_until(m_num_pop_waiters, m_cond_pop, [this]{ return readable() || is_closed(); }, abs_time)) {
+                return false;
+            }
+        }
+        wake(m_num_push_waiters, m_cond_push);
+        return true;
+    }
+
+    Producer register_producer() noexcept {
+        for (size_type i = 0; i < MAX_PRODUCERS; i++) {
+            auto expected = LaneState::free;
+            if (m_lanes[i].state.compare_exchange_strong(expected, LaneState::active, std::memory_order_acq_rel)) {
+                return Producer { this, i };
+            }
+        }
+        return Producer {};
+    }
+
+    size_type size() const noexcept {
+        size_type n { 0 };
+        for (const auto& lane : m_lanes) {
+            if (lane.state.load(std::memory_order_acquire) != LaneState::free) {
+                n += lane.buffer.size();
+            }
+        }
+        return n;
+    }
+
+    bool try_pop(value_type& val) {
+        if (!dequeue(val)) {
+            return false;
+        }
+        wake(m_num_push_waiters, m_cond_push);
+        return true;
+    }
+};
+
+} // inline namespace sharded_mailbox
+
+} // namespace cun
+
+#endif // ndef CUN_SHARDED_MAILBOX_HPP_INCLUDED
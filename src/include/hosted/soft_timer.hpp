@@ -7,10 +7,10 @@
 #define CUN_SOFT_TIMER_HPP_INCLUDED
 
 // C++ standard library
-#include <atomic>
+#include <algorithm>
 #include <chrono>
+#include <condition_variable>
 #include <cstdint>
-#include <future>
 #include <mutex>
 #include <stdexcept>
 #include <thread>
@@ -30,11 +30,70 @@ using size_type = std::int_fast32_t;
 /** Repeat forever. */
 constexpr size_type FOREVER { -1 };
 
-/** Simple software timer context class. */
+/** Policy for the ticks which are overdue after an action. */
+enum class OverrunPolicy {
+    catch_up,        // Run the overdue actions back to back (default).
+    skip,            // Skip the overdue ticks, and keep the phase.
+    from_completion, // Run the next action a period after the action is completed.
+};
+
+namespace impl {
+
+/**
+ * Updates next_time after an action completed at now, and returns the
+ * number of the ticks newly found overdue. overdue_end remembers the ticks
+ * already counted, so a catch-up burst is counted only once.
+ */
+template <typename TimePointT, typename DurationT>
+std::uint64_t reschedule(const OverrunPolicy policy,
+                         const DurationT& period,
+                         const TimePointT& now,
+                         TimePointT& next_time,
+                         TimePointT& overdue_end) noexcept
+{
+    using rep = typename DurationT::rep;
+
+    std::uint64_t missed { 0 };
+    if (const auto first = std::max(next_time, overdue_end); now >= first) {
+        missed = static_cast<std::uint64_t>((now - first) / period) + 1;
+        overdue_end = first + static_cast<rep>(missed) * period;
+    }
+
+    switch (policy) {
+    case OverrunPolicy::skip:
+        if (now >= next_time) {
+            next_time += static_cast<rep>((now - next_time) / period + 1) * period;
+        }
+        break;
+    case OverrunPolicy::from_completion:
+        next_time = now + period;
+        break;
+    case OverrunPolicy::catch_up:
+    default:
+        break;
+    }
+    return missed;
+}
+
+} // namespace impl
+
+/**
+ * Simple software timer context class.
+ *
+ * The worker thread is created by the first start and parked while the
+ * timer is stopped, so stop / start / restart only wake it up. stop waits
+ * for the running action, unless it is called from the action.
+ *
+ * If an action overruns the following ticks, they are run back to back by
+ * default; set_overrun_policy selects another OverrunPolicy. missed_ticks
+ * returns the number of the ticks found overdue since start. The repeat
+ * count counts the actions run, not the skipped ticks.
+ */
 template <typename RepT, typename PeriodT, typename ActionT>
 class SoftTimer {
 private:
     using duration = std::chrono::duration<RepT, PeriodT>;
+    using clock_type = std::chrono::steady_clock;
 
     const size_type m_max_repeat_times { FOREVER };
     const duration m_period;
@@ -42,11 +101,20 @@ private:
 
     ActionT m_action;
 
-    std::atomic_bool m_expired { false };
+    // The members below are guarded by m_mutex.
     mutable std::mutex m_mutex;
-    std::promise<void> m_pr_fin;
+    std::condition_variable m_cond;
+    std::condition_variable m_cond_done;
+    std::uint64_t m_generation { 0 }; // Bumped by start / stop, to cancel the pending wait.
+    clock_type::time_point m_next_action_time;
+    clock_type::time_point m_overdue_end;
+    std::uint64_t m_missed_ticks { 0 };
+    OverrunPolicy m_overrun_policy { OverrunPolicy::catch_up };
     size_type m_repeat_times { 0 };
     std::thread m_thread;
+    bool m_closed { false };
+    bool m_expired { false };
+    bool m_running { false };
     bool m_working { false };
 
     static void check_period(const duration& period) {
@@ -63,33 +131,80 @@ private:
         }
     }
 
-    void main_loop(std::promise<void>& pr_init,
-                   std::future<void>& fu_fin,
-                   std::chrono::steady_clock::time_point next_action_time) noexcept {
-        m_expired = false;
-        m_repeat_times = 0;
-
-        pr_init.set_value();
+    void main_loop() noexcept {
+        std::unique_lock<std::mutex> lck { m_mutex };
 
-        while (fu_fin.wait_until(next_action_time) == std::future_status::timeout) {
-            next_action_time += m_period;
+        while (!m_closed) {
+            if (!m_working || m_expired) {
+                m_cond.wait(lck);
+                continue;
+            }
 
-            if (m_expired) {
+            const auto generation = m_generation;
+            if (m_cond.wait_until(lck, m_next_action_time, [this, generation]{
+                    return m_closed || (m_generation != generation);
+                })) {
                 continue;
             }
+            m_next_action_time += m_period;
 
+            m_running = true;
+            lck.unlock();
             try {
                 m_action();
             } catch (...) {
                 /*EMPTY*/
             }
+            lck.lock();
+            m_running = false;
+            m_cond_done.notify_all();
 
+            if (m_generation != generation) {
+                // Stopped or restarted by the action or another thread.
+                continue;
+            }
             if (m_max_repeat_times >= 0) {
                 m_repeat_times++;
                 if (m_repeat_times >= m_max_repeat_times) {
                     m_expired = true;
+                    continue;
                 }
             }
+            m_missed_ticks += impl::reschedule(m_overrun_policy, m_period, clock_type::now(),
+                                               m_next_action_time, m_overdue_end);
+        }
+    }
+
+    // Requires m_mutex to be locked by lck.
+    void wait_for_action(std::unique_lock<std::mutex>& lck) {
+        if (m_thread.get_id() == std::this_thread::get_id()) {
+            return;
+        }
+        m_cond_done.wait(lck, [this]{ return !m_running; });
+    }
+
+    // Requires m_mutex to be locked, so a new thread waits for the state below.
+    void arm() {
+        const auto started = !m_thread.joinable();
+        if (started) {
+            // If this throws, the timer stays stopped.
+            m_thread = std::thread { [this]{ main_loop(); } };
+        }
+
+        m_generation++;
+        m_expired = false;
+        m_missed_ticks = 0;
+        m_overdue_end = clock_type::time_point::min();
+        m_repeat_times = 0;
+        m_working = true;
+
+        m_next_action_time = clock_type::now();
+        if (!m_run_immediately) {
+            m_next_action_time += m_period;
+        }
+
+        if (!started) {
+            m_cond.notify_one();
         }
     }
 
@@ -124,6 +239,15 @@ public:
 
     virtual ~SoftTimer() {
         (void) stop();
+
+        {
+            std::lock_guard<std::mutex> lck { m_mutex };
+            m_closed = true;
+        }
+        m_cond.notify_one();
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
     }
 
     SoftTimer(const SoftTimer& other) :
@@ -137,6 +261,7 @@ public:
         if (other.m_working) {
             throw std::invalid_argument("SoftTimer: cannot copy working timer");
         }
+        m_overrun_policy = other.m_overrun_policy;
     }
 
     SoftTimer(SoftTimer&& other) :
@@ -150,6 +275,7 @@ public:
         if (other.m_working) {
             throw std::invalid_argument("SoftTimer: cannot move working timer");
         }
+        m_overrun_policy = other.m_overrun_policy;
     }
 
     bool expired() const {
@@ -157,9 +283,21 @@ public:
         return m_working && m_expired;
     }
 
+    std::uint64_t missed_ticks() const {
+        std::lock_guard<std::mutex> lck { m_mutex };
+        return m_missed_ticks;
+    }
+
+    void set_overrun_policy(const OverrunPolicy policy) {
+        std::lock_guard<std::mutex> lck { m_mutex };
+        m_overrun_policy = policy;
+    }
+
     bool restart() {
-        (void) stop();
-        return start();
+        std::unique_lock<std::mutex> lck { m_mutex };
+        wait_for_action(lck);
+        arm();
+        return true;
     }
 
     bool start() {
@@ -167,41 +305,20 @@ public:
         if (m_working) {
             return false;
         }
-
-        auto next_action_time = std::chrono::steady_clock::now();
-        if (!m_run_immediately) {
-            next_action_time += m_period;
-        }
-
-        std::promise<void> pr_init;
-        auto fu_init = pr_init.get_future();
-
-        m_pr_fin = std::promise<void> {};
-        auto fu_fin = m_pr_fin.get_future();
-
-        m_thread = std::thread { [this,
-                                  pr = std::move(pr_init),
-                                  fu = std::move(fu_fin),
-                                  &next_action_time]() mutable {
-            main_loop(pr, fu, next_action_time);
-        }};
-        fu_init.get();
-
-        m_working = true;
-
+        arm();
         return true;
     };
 
     bool stop() {
-        std::lock_guard<std::mutex> lck { m_mutex };
+        std::unique_lock<std::mutex> lck { m_mutex };
         if (!m_working) {
             return true;
         }
 
-        m_pr_fin.set_value();
-        m_thread.join();
-
+        m_generation++;
         m_working = false;
+        m_cond.notify_one();
+        wait_for_action(lck);
 
         return true;
     };
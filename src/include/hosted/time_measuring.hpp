@@ -215,6 +215,26 @@ public:
     }
 };
 
+/** A time measuring class logging durations measured by the caller. */
+template <
+    std::size_t MAX_LOG,
+    typename UNIT = std::chrono::microseconds,
+    typename CLOCK = std::chrono::steady_clock
+>
+class DurationLog final : public TimeMeasuring<MAX_LOG, UNIT, CLOCK> {
+private:
+    using super = TimeMeasuring<MAX_LOG, UNIT, CLOCK>;
+
+public:
+    using super::TimeMeasuring;
+
+    void record(const typename super::duration& value) noexcept {
+        this->m_data[this->m_wp] = value;
+        this->m_wp = super::next_index_of(this->m_wp);
+        this->m_num_log = super::next_count_of(this->m_num_log);
+    }
+};
+
 } // inline namespace time_measuring
 
 } // namespace cun
@@ -0,0 +1,414 @@
+﻿// -*- coding: utf-8-with-signature-dos -*-
+// vim:fileencoding=utf-8:ff=dos
+//
+// A timer service driving many software timers with a few threads.
+
+#ifndef CUN_TIMER_SERVICE_HPP_INCLUDED
+#define CUN_TIMER_SERVICE_HPP_INCLUDED
+
+// C++ standard library
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// C++ user library
+#include "soft_timer.hpp"
+
+namespace cun {
+
+namespace soft_timer {
+
+/* ---------------------------------------------------------------------- */
+/*  */
+/* ---------------------------------------------------------------------- */
+
+class ServiceTimer;
+
+/**
+ * Timer service class driving many timers with a few threads.
+ *
+ * The timers are lightweight handles (ServiceTimer) with the same semantics
+ * as SoftTimer, and their deadlines are kept in one heap shared by the
+ * threads of the service. An action is called on one of the threads, never
+ * concurrently with itself, so a long action delays the other timers unless
+ * the service has more threads. The overrun policy and the missed ticks are
+ * also the same as SoftTimer.
+ *
+ * A timer may have a slack (set_slack): its wake-up time is rounded up to
+ * a multiple of the slack, so the timers with nearby deadlines share one
+ * wake-up and are fired in one pass. The action may be delayed by less
+ * than the slack, and periodic timers keep their nominal schedule. The
+ * slacks which are multiples of each other share more wake-ups. The slack
+ * must be less than the period.
+ *
+ * The timers must be destroyed before the service.
+ */
+class TimerService final {
+public:
+    using clock_type = std::chrono::steady_clock;
+    using duration = clock_type::duration;
+
+private:
+    friend class ServiceTimer;
+
+    // The members below action are guarded by TimerService::m_mutex.
+    struct Entry final {
+        const duration period;
+        const size_type max_repeat_times;
+        const bool run_immediately;
+        std::function<void()> action;
+
+        std::uint64_t generation { 0 }; // Bumped by start / stop, to invalidate the queued deadline.
+        size_type repeat_times { 0 };
+        OverrunPolicy overrun_policy { OverrunPolicy::catch_up };
+        duration slack { duration::zero() };
+        std::uint64_t missed_ticks { 0 };
+        clock_type::time_point overdue_end;
+        bool working { false };
+        bool expired { false };
+        bool running { false };
+        std::thread::id runner;
+        std::optional<clock_type::time_point> pending_start; // Started while the action was running.
+
+        template <typename ActionT>
+        Entry(const duration& period, const size_type max_repeat_times, const bool run_immediately, ActionT&& action) :
+            period { period },
+            max_repeat_times { max_repeat_times },
+            run_immediately { run_immediately },
+            action { std::forward<ActionT>(action) } {}
+    };
+
+    using entry_ptr = std::shared_ptr<Entry>;
+
+    struct Deadline final {
+        clock_type::time_point time;    // Wake-up time, rounded up by the slack.
+        clock_type::time_point nominal; // Deadline without the slack.
+        std::uint64_t generation;
+        entry_ptr entry;
+
+        bool operator>(const Deadline& rhs) const noexcept {
+            return time > rhs.time;
+        }
+    };
+
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::condition_variable m_cond_done;
+    std::priority_queue<Deadline, std::vector<Deadline>, std::greater<>> m_deadlines;
+    bool m_closed { false };
+    std::vector<std::thread> m_threads;
+
+    static void check_period(const duration& period) {
+        if (period <= duration::zero()) {
+            throw std::invalid_argument("TimerService: period must be greater than 0");
+            /*NOTREACHED*/
+        }
+    }
+
+    static void check_repeat_times(const size_type repeat_times) {
+        if (repeat_times == 0) {
+            throw std::invalid_argument("TimerService: repeat times must not be 0");
+            /*NOTREACHED*/
+        }
+    }
+
+    static void check_slack(const duration& slack, const duration& period) {
+        if (slack < duration::zero()) {
+            throw std::invalid_argument("TimerService: slack must not be negative");
+            /*NOTREACHED*/
+        }
+        if (slack >= period) {
+            throw std::invalid_argument("TimerService: slack must be less than period");
+            /*NOTREACHED*/
+        }
+    }
+
+    static clock_type::time_point round_up(const clock_type::time_point time, const duration& slack) noexcept {
+        if (slack <= duration::zero()) {
+            return time;
+        }
+        const auto rem = time.time_since_epoch() % slack;
+        return (rem == duration::zero()) ? time : time + (slack - rem);
+    }
+
+    // Requires m_mutex to be locked.
+    void schedule(const entry_ptr& entry, const clock_type::time_point time) {
+        m_deadlines.push(Deadline { round_up(time, entry->slack), time, entry->generation, entry });
+        if (m_deadlines.top().entry == entry) {
+            m_cond.notify_one();
+        }
+    }
+
+    // Requires m_mutex to be locked by lck.
+    void fire(std::unique_lock<std::mutex>& lck, const entry_ptr& entry, const clock_type::time_point time) {
+        const auto generation = entry->generation;
+
+        entry->running = true;
+        entry->runner = std::this_thread::get_id();
+        lck.unlock();
+        try {
+            entry->action();
+        } catch (...) {
+            /*EMPTY*/
+        }
+        lck.lock();
+        entry->running = false;
+        m_cond_done.notify_all();
+
+        if (entry->generation != generation) {
+            // Stopped or restarted by the action or another thread.
+            if (entry->pending_start) {
+                schedule(entry, *entry->pending_start);
+                entry->pending_start.reset();
+            }
+            return;
+        }
+        if (entry->max_repeat_times >= 0) {
+            entry->repeat_times++;
+            if (entry->repeat_times >= entry->max_repeat_times) {
+                entry->expired = true;
+                return;
+            }
+        }
+        auto next_time = time + entry->period;
+        entry->missed_ticks += impl::reschedule(entry->overrun_policy, entry->period, clock_type::now(),
+                                                next_time, entry->overdue_end);
+        schedule(entry, next_time);
+    }
+
+    void worker() noexcept {
+        std::unique_lock<std::mutex> lck { m_mutex };
+        while (!m_closed) {
+            if (m_deadlines.empty()) {
+                m_cond.wait(lck);
+                continue;
+            }
+            const auto& top = m_deadlines.top();
+            if (top.generation != top.entry->generation) {
+                m_deadlines.pop();
+                continue;
+            }
+            const auto time = top.time;
+            if (clock_type::now() < time) {
+                (void) m_cond.wait_until(lck, time);
+                continue;
+            }
+            const auto nominal = top.nominal;
+            auto entry = top.entry;
+            m_deadlines.pop();
+            fire(lck, entry, nominal);
+        }
+    }
+
+    bool start(const entry_ptr& entry) {
+        std::lock_guard<std::mutex> lck { m_mutex };
+        if (entry->working) {
+            return false;
+        }
+        entry->generation++;
+        entry->repeat_times = 0;
+        entry->missed_ticks = 0;
+        entry->overdue_end = clock_type::time_point::min();
+        entry->working = true;
+        entry->expired = false;
+
+        auto time = clock_type::now();
+        if (!entry->run_immediately) {
+            time += entry->period;
+        }
+        if (entry->running) {
+            // Scheduled by fire after the action returns, never to run it concurrently.
+            entry->pending_start = time;
+        } else {
+            schedule(entry, time);
+        }
+        return true;
+    }
+
+    bool stop(const entry_ptr& entry) {
+        std::unique_lock<std::mutex> lck { m_mutex };
+        if (!entry->working) {
+            return true;
+        }
+        entry->generation++;
+        entry->working = false;
+        entry->pending_start.reset();
+
+        // Wait for the running action, unless it is the caller.
+        m_cond_done.wait(lck, [&entry]{
+            return !entry->running || (entry->runner == std::this_thread::get_id());
+        });
+        return true;
+    }
+
+    bool expired(const entry_ptr& entry) {
+        std::lock_guard<std::mutex> lck { m_mutex };
+        return entry->working && entry->expired;
+    }
+
+    std::uint64_t missed_ticks(const entry_ptr& entry) {
+        std::lock_guard<std::mutex> lck { m_mutex };
+        return entry->missed_ticks;
+    }
+
+    void set_overrun_policy(const entry_ptr& entry, const OverrunPolicy policy) {
+        std::lock_guard<std::mutex> lck { m_mutex };
+        entry->overrun_policy = policy;
+    }
+
+    void set_slack(const entry_ptr& entry, const duration& slack) {
+        check_slack(slack, entry->period);
+        std::lock_guard<std::mutex> lck { m_mutex };
+        entry->slack = slack;
+    }
+
+    template <typename RepT, typename PeriodT, typename ActionT>
+    entry_ptr make_entry(const std::chrono::duration<RepT, PeriodT>& period, const size_type repeat_times,
+                         const bool run_immediately, ActionT&& action) {
+        const auto interval = std::chrono::duration_cast<duration>(period);
+        check_period(interval);
+        check_repeat_times(repeat_times);
+        return std::make_shared<Entry>(interval, (repeat_times >= 0) ? repeat_times : FOREVER,
+                                       run_immediately, std::forward<ActionT>(action));
+    }
+
+public:
+    explicit TimerService(const std::size_t num_threads = 1) {
+        for (std::size_t i = 0; i < std::max<std::size_t>(num_threads, 1); i++) {
+            m_threads.emplace_back([this]{ worker(); });
+        }
+    }
+
+    ~TimerService() {
+        {
+            std::lock_guard<std::mutex> lck { m_mutex };
+            m_closed = true;
+        }
+        m_cond.notify_all();
+        for (auto& thread : m_threads) {
+            thread.join();
+        }
+    }
+
+    TimerService(const TimerService&) = delete;
+    TimerService& operator=(const TimerService&) = delete;
+
+    std::size_t num_threads() const noexcept {
+        return m_threads.size();
+    }
+
+    template <typename RepT, typename PeriodT, typename ActionT>
+    ServiceTimer create(const std::chrono::duration<RepT, PeriodT>& period, ActionT&& action);
+
+    template <typename RepT, typename PeriodT, typename ActionT>
+    ServiceTimer create(const std::chrono::duration<RepT, PeriodT>& period, const size_type repeat_times, ActionT&& action);
+
+    template <typename RepT, typename PeriodT, typename ActionT>
+    ServiceTimer create(const std::chrono::duration<RepT, PeriodT>& period, const size_type repeat_times, const bool run_immediately, ActionT&& action);
+};
+
+/** A software timer handle driven by TimerService. */
+class ServiceTimer final {
+private:
+    friend class TimerService;
+
+    TimerService *m_service { nullptr };
+    TimerService::entry_ptr m_entry;
+
+    ServiceTimer(TimerService& service, TimerService::entry_ptr&& entry) :
+        m_service { &service },
+        m_entry { std::move(entry) } {}
+
+public:
+    ServiceTimer() = default;
+
+    ~ServiceTimer() {
+        (void) stop();
+    }
+
+    ServiceTimer(const ServiceTimer&) = delete;
+    ServiceTimer& operator=(const ServiceTimer&) = delete;
+
+    ServiceTimer(ServiceTimer&& other) noexcept :
+        m_service { std::exchange(other.m_service, nullptr) },
+        m_entry { std::move(other.m_entry) } {}
+
+    ServiceTimer& operator=(ServiceTimer&& other) noexcept {
+        if (this != &other) {
+            (void) stop();
+            m_service = std::exchange(other.m_service, nullptr);
+            m_entry = std::move(other.m_entry);
+        }
+        return *this;
+    }
+
+    bool expired() const {
+        return (m_entry != nullptr) && m_service->expired(m_entry);
+    }
+
+    std::uint64_t missed_ticks() const {
+        return (m_entry != nullptr) ? m_service->missed_ticks(m_entry) : 0;
+    }
+
+    void set_overrun_policy(const OverrunPolicy policy) {
+        if (m_entry != nullptr) {
+            m_service->set_overrun_policy(m_entry, policy);
+        }
+    }
+
+    /** Sets the slack, which takes effect from the next deadline. */
+    template <typename RepT, typename PeriodT>
+    void set_slack(const std::chrono::duration<RepT, PeriodT>& slack) {
+        if (m_entry != nullptr) {
+            m_service->set_slack(m_entry, std::chrono::duration_cast<TimerService::duration>(slack));
+        }
+    }
+
+    bool restart() {
+        (void) stop();
+        return start();
+    }
+
+    bool start() {
+        return (m_entry != nullptr) && m_service->start(m_entry);
+    }
+
+    bool stop() {
+        return (m_entry == nullptr) || m_service->stop(m_entry);
+    }
+};
+
+template <typename RepT, typename PeriodT, typename ActionT>
+ServiceTimer TimerService::create(const std::chrono::duration<RepT, PeriodT>& period, ActionT&& action)
+{
+    return ServiceTimer { *this, make_entry(period, FOREVER, false, std::forward<ActionT>(action)) };
+}
+
+template <typename RepT, typename PeriodT, typename ActionT>
+ServiceTimer TimerService::create(const std::chrono::duration<RepT, PeriodT>& period, const size_type repeat_times, ActionT&& action)
+{
+    return ServiceTimer { *this, make_entry(period, repeat_times, false, std::forward<ActionT>(action)) };
+}
+
+template <typename RepT, typename PeriodT, typename ActionT>
+ServiceTimer TimerService::create(const std::chrono::duration<RepT, PeriodT>& period, const size_type repeat_times, const bool run_immediately, ActionT&& action)
+{
+    return ServiceTimer { *this, make_entry(period, repeat_times, run_immediately, std::forward<ActionT>(action)) };
+}
+
+} // namespace soft_timer
+
+} // namespace cun
+
+#endif // ndef CUN_TIMER_SERVICE_HPP_INCLUDED
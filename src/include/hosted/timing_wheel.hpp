@@ -0,0 +1,310 @@
+﻿// -*- coding: utf-8-with-signature-dos -*-
+// vim:fileencoding=utf-8:ff=dos
+//
+// A hashed hierarchical timing wheel.
+
+#ifndef CUN_TIMING_WHEEL_HPP_INCLUDED
+#define CUN_TIMING_WHEEL_HPP_INCLUDED
+
+// C++ standard library
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+/* ---------------------------------------------------------------------- */
+/*  */
+/* ---------------------------------------------------------------------- */
+
+namespace cun {
+
+inline namespace timing_wheel {
+
+/**
+ * Hashed hierarchical timing wheel class.
+ *
+ * The wheel has NUM_LEVELS levels of 2^LEVEL_BITS slots, and a slot of the
+ * level L covers 2^(LEVEL_BITS * L) ticks. A timer is linked into the slot
+ * of the lowest level that can hold its expiry, so schedule and cancel are
+ * O(1). The timers of a higher level are moved down when the lower level
+ * wraps around, and the timers of a slot of the level 0 are expired in a
+ * batch when the wheel advances to the tick. A timer beyond MAX_DELAY ticks
+ * is parked at the highest level until it comes within range.
+ *
+ * The wheel is not thread safe and has no thread: the owner calls advance
+ * or advance_to periodically (e.g. once a tick) and the expired values are
+ * passed to the function object. The function object may schedule or cancel
+ * timers. A timer is never expired before its expiry, and at most one tick
+ * late if the wheel is advanced every tick.
+ */
+template <
+    typename T,
+    unsigned LEVEL_BITS = 6,
+    unsigned NUM_LEVELS = 4,
+    typename ClockT = std::chrono::steady_clock
+>
+class TimingWheel final {
+    static_assert(LEVEL_BITS > 0, "TimingWheel: 0 bits level is not allowed.");
+    static_assert(NUM_LEVELS > 0, "TimingWheel: 0 levels wheel is not allowed.");
+    static_assert(LEVEL_BITS * NUM_LEVELS < 64, "TimingWheel: too large wheel.");
+
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using tick_type = std::uint64_t;
+    using timer_id = std::uint64_t;
+    using clock_type = ClockT;
+    using duration = typename ClockT::duration;
+    using time_point = typename ClockT::time_point;
+
+    static constexpr tick_type SLOTS_PER_LEVEL { tick_type { 1 } << LEVEL_BITS };
+    static constexpr tick_type MAX_DELAY { (tick_type { 1 } << (LEVEL_BITS * NUM_LEVELS)) - 1 };
+
+private:
+    using index_type = std::uint32_t;
+
+    static constexpr index_type NIL { std::numeric_limits<index_type>::max() };
+    static constexpr tick_type SLOT_MASK { SLOTS_PER_LEVEL - 1 };
+
+    struct Node final {
+        std::optional<T> value;
+        tick_type expiry { 0 };
+        index_type prev { NIL };
+        index_type next { NIL };
+        index_type slot { NIL }; // NIL if the node is free.
+        std::uint32_t generation { 1 };
+    };
+
+    duration m_tick;
+    time_point m_origin;
+    tick_type m_now { 0 };
+    std::array<index_type, SLOTS_PER_LEVEL * NUM_LEVELS> m_slots;
+    std::vector<Node> m_nodes;
+    index_type m_free { NIL };
+    size_type m_size { 0 };
+
+    static constexpr timer_id make_id(const index_type index, const std::uint32_t generation) noexcept {
+        return (static_cast<timer_id>(generation) << 32) | index;
+    }
+
+    void link(const index_type index) noexcept {
+        auto& node = m_nodes[index];
+
+        const auto delay = std::min(node.expiry - m_now, MAX_DELAY);
+        const auto expiry = m_now + delay;
+        unsigned level { 0 };
+        while ((level + 1 < NUM_LEVELS) && (delay >> (LEVEL_BITS * (level + 1)) != 0)) {
+            level++;
+        }
+        const auto slot = static_cast<index_type>(level * SLOTS_PER_LEVEL + ((expiry >> (LEVEL_BITS * level)) & SLOT_MASK));
+
+        node.slot = slot;
+        node.prev = NIL;
+        node.next = m_slots[slot];
+        if (node.next != NIL) {
+            m_nodes[node.next].prev = index;
+        }
+        m_slots[slot] = index;
+    }
+
+    void unlink(const index_type index) noexcept {
+        auto& node = m_nodes[index];
+        if (node.prev != NIL) {
+            m_nodes[node.prev].next = node.next;
+        } else {
+            m_slots[node.slot] = node.next;
+        }
+        if (node.next != NIL) {
+            m_nodes[node.next].prev = node.prev;
+        }
+    }
+
+    index_type acquire() {
+        if (m_free != NIL) {
+            const auto index = m_free;
+            m_free = m_nodes[index].next;
+            return index;
+        }
+        if (m_nodes.size() >= NIL) {
+            throw std::length_error("TimingWheel: too many timers");
+            /*NOTREACHED*/
+        }
+        m_nodes.emplace_back();
+        return static_cast<index_type>(m_nodes.size() - 1);
+    }
+
+    void release(const index_type index) noexcept {
+        auto& node = m_nodes[index];
+        node.value.reset();
+        node.slot = NIL;
+        if (++node.generation == 0) {
+            node.generation = 1;
+        }
+        node.next = m_free;
+        m_free = index;
+        m_size--;
+    }
+
+    // Moves the timers in the current slot of the level down.
+    void cascade(const unsigned level) noexcept {
+        const auto slot = level * SLOTS_PER_LEVEL + ((m_now >> (LEVEL_BITS * level)) & SLOT_MASK);
+        auto index = std::exchange(m_slots[slot], NIL);
+        while (index != NIL) {
+            const auto next = m_nodes[index].next;
+            link(index);
+            index = next;
+        }
+    }
+
+    template <typename FuncT>
+    size_type step(FuncT& func) {
+        m_now++;
+        for (unsigned level = 1; level < NUM_LEVELS; level++) {
+            if ((m_now & ((tick_type { 1 } << (LEVEL_BITS * level)) - 1)) != 0) {
+                break;
+            }
+            cascade(level);
+        }
+
+        size_type n { 0 };
+        auto& head = m_slots[m_now & SLOT_MASK];
+        while (head != NIL) {
+            const auto index = head;
+            unlink(index);
+            if (m_nodes[index].expiry > m_now) {
+                // Parked beyond MAX_DELAY.
+                link(index);
+                continue;
+            }
+            auto value = std::move(*m_nodes[index].value);
+            release(index);
+            func(value);
+            n++;
+        }
+        return n;
+    }
+
+    template <typename U>
+    timer_id insert(const tick_type expiry, U&& value) {
+        const auto index = acquire();
+        auto& node = m_nodes[index];
+        try {
+            node.value.emplace(std::forward<U>(value));
+        } catch (...) {
+            node.next = m_free;
+            m_free = index;
+            throw;
+        }
+        node.expiry = std::max(expiry, m_now + 1);
+        link(index);
+        m_size++;
+        return make_id(index, node.generation);
+    }
+
+public:
+    explicit TimingWheel(const duration& tick, const time_point& origin = clock_type::now()) :
+            m_tick { tick },
+            m_origin { origin } {
+        if (tick <= duration::zero()) {
+            throw std::invalid_argument("TimingWheel: tick must be greater than 0");
+            /*NOTREACHED*/
+        }
+        m_slots.fill(NIL);
+    }
+
+    TimingWheel(const TimingWheel&) = delete;
+    TimingWheel& operator=(const TimingWheel&) = delete;
+
+    duration tick() const noexcept {
+        return m_tick;
+    }
+
+    tick_type current_tick() const noexcept {
+        return m_now;
+    }
+
+    size_type size() const noexcept {
+        return m_size;
+    }
+
+    bool empty() const noexcept {
+        return m_size == 0;
+    }
+
+    /** Schedules the value to be expired after delay ticks (at least 1). */
+    template <typename U>
+    timer_id schedule(const tick_type delay, U&& value) {
+        return insert(m_now + std::max<tick_type>(delay, 1), std::forward<U>(value));
+    }
+
+    /** Schedules the value to be expired at the first tick not before time. */
+    template <typename U>
+    timer_id schedule_at(const time_point& time, U&& value) {
+        const auto elapsed = time - m_origin;
+        const auto expiry = (elapsed > duration::zero())
+                          ? static_cast<tick_type>((elapsed + m_tick - duration { 1 }) / m_tick)
+                          : tick_type { 0 };
+        return insert(expiry, std::forward<U>(value));
+    }
+
+    template <typename RepT, typename PeriodT, typename U>
+    timer_id schedule_after(const std::chrono::duration<RepT, PeriodT>& delay, U&& value) {
+        return schedule_at(clock_type::now() + std::chrono::ceil<duration>(delay), std::forward<U>(value));
+    }
+
+    bool cancel(const timer_id id) noexcept {
+        const auto index = static_cast<index_type>(id);
+        const auto generation = static_cast<std::uint32_t>(id >> 32);
+        if ((index >= m_nodes.size()) ||
+            (m_nodes[index].slot == NIL) ||
+            (m_nodes[index].generation != generation)) {
+            return false;
+        }
+        unlink(index);
+        release(index);
+        return true;
+    }
+
+    /**
+     * Advances the wheel by ticks, and calls func(value) for each expired
+     * value. Returns the number of the expired values.
+     */
+    template <typename FuncT>
+    size_type advance(const tick_type ticks, FuncT&& func) {
+        const auto target = m_now + ticks;
+        size_type n { 0 };
+        while (m_now < target) {
+            if (m_size == 0) {
+                m_now = target;
+                break;
+            }
+            n += step(func);
+        }
+        return n;
+    }
+
+    /** Advances the wheel to the last tick not after now. */
+    template <typename FuncT>
+    size_type advance_to(const time_point& now, FuncT&& func) {
+        if (now <= m_origin) {
+            return 0;
+        }
+        const auto target = static_cast<tick_type>((now - m_origin) / m_tick);
+        if (target <= m_now) {
+            return 0;
+        }
+        return advance(target - m_now, std::forward<FuncT>(func));
+    }
+};
+
+} // inline namespace timing_wheel
+
+} // namespace cun
+
+#endif // ndef CUN_TIMING_WHEEL_HPP_INCLUDED
@@ -0,0 +1,165 @@
+﻿// -*- coding: utf-8-with-signature-dos -*-
+// vim:fileencoding=utf-8:ff=dos
+//
+// An event loop toolbox without dynamic memory allocation per event.
+
+#ifndef TYPED_EVENT_LOOP_HPP_INCLUDED
+#define TYPED_EVENT_LOOP_HPP_INCLUDED
+
+// C++ standard library
+#include <cstddef>
+#include <map>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+// C++ user library
+#include "event_loop.hpp"
+#include "inline_any.hpp"
+#include "mailbox.hpp"
+
+/* ---------------------------------------------------------------------- */
+/*  */
+/* ---------------------------------------------------------------------- */
+
+namespace cun {
+
+inline namespace typed_event_loop {
+
+/**
+ * Event loop toolbox class without dynamic memory allocation per event.
+ *
+ * This is a variant of EventLoop: arguments and results are stored in
+ * InlineAny of ARGS_SIZE bytes inside the mail, handlers are plain function
+ * pointers, and the mails are queued in a FixedMailbox of QUEUE_SIZE mails.
+ * So neither post_event nor send_event touches the global allocator.
+ * post_event blocks while the mailbox is full. As with EventLoop, EntryT
+ * may be EnumTableOf<N>::type for a dense enumeration.
+ */
+template <
+    typename UserEventT,
+    ContextPtr ContextPtrT = void *,
+    RVTraits RVTraitsT = ReturnTraits<bool>,
+    std::size_t ARGS_SIZE = 32,
+    std::size_t QUEUE_SIZE = 256,
+    template <typename, typename> class EntryT = std::map
+>
+class TypedEventLoop {
+public:
+    using return_type = typename RVTraitsT::type;
+    using args_type = InlineAny<ARGS_SIZE>;
+    using event_proc = return_type (*)(ContextPtrT, args_type&, args_type&);
+    using event_entry = EntryT<UserEventT, event_proc>;
+
+private:
+    using completion_type = CompletionSlot<return_type>;
+
+    struct Mail final {
+        UserEventT type {};
+        completion_type *completion { nullptr };
+        args_type args;
+        args_type results;
+    };
+
+    static constexpr std::size_t MAX_MAILS_PER_WAKEUP { 32 };
+
+    ContextPtrT m_context;
+    FixedMailbox<Mail, QUEUE_SIZE> m_mailbox;
+    event_entry m_event_entry;
+    std::thread m_thread;
+
+    void main_loop() noexcept {
+        Mail mails[MAX_MAILS_PER_WAKEUP];
+
+        // The mailbox returns no mail only after it is closed and drained.
+        while (const auto n = m_mailbox.pop_n(mails, MAX_MAILS_PER_WAKEUP)) {
+            for (std::size_t i = 0; i < n; i++) {
+                auto& mail = mails[i];
+
+                auto retval = RVTraitsT::event_not_found();
+                auto p = m_event_entry.find(mail.type);
+                if (p != m_event_entry.end()) {
+                    retval = p->second(m_context, mail.args, mail.results);
+                }
+
+                if (mail.completion != nullptr) {
+                    mail.completion->set_value(retval);
+                }
+
+                mail = Mail {};
+            }
+        }
+    }
+
+    return_type send_mail(const UserEventT type, args_type&& args, args_type&& results) noexcept {
+        try {
+            completion_type completion;
+            if (!m_mailbox.emplace(type, &completion, std::move(args), std::move(results))) {
+                return RVTraitsT::ng();
+            }
+            return completion.wait();
+        } catch (...) {
+            return RVTraitsT::ng();
+        }
+    }
+
+    return_type post_mail(const UserEventT type, args_type&& args) noexcept {
+        try {
+            if (!m_mailbox.emplace(type, nullptr, std::move(args), args_type {})) {
+                return RVTraitsT::ng();
+            }
+            return RVTraitsT::ok();
+        } catch (...) {
+            return RVTraitsT::ng();
+        }
+    }
+
+public:
+    explicit TypedEventLoop(event_entry&& event_entry = {},
+                            ContextPtrT context = nullptr) :
+            m_context { context },
+            m_event_entry { std::move(event_entry) } {
+        m_thread = std::thread { [this]{ main_loop(); } };
+    }
+
+    explicit TypedEventLoop(const event_entry& event_entry,
+                            ContextPtrT context = nullptr) :
+            m_context { context },
+            m_event_entry { event_entry } {
+        m_thread = std::thread { [this]{ main_loop(); } };
+    }
+
+    virtual ~TypedEventLoop() {
+        m_mailbox.close();
+        m_thread.join();
+    }
+
+    template <typename ArgsT, typename ResultsT>
+    return_type send_event(const UserEventT type, ArgsT&& args, ResultsT&& results) noexcept {
+        return send_mail(type, args_type { std::forward<ArgsT>(args) }, args_type { std::forward<ResultsT>(results) });
+    }
+
+    template <typename ArgsT>
+    return_type send_event(const UserEventT type, ArgsT&& args) noexcept {
+        return send_mail(type, args_type { std::forward<ArgsT>(args) }, args_type {});
+    }
+
+    return_type send_event(const UserEventT type) noexcept {
+        return send_mail(type, args_type {}, args_type {});
+    }
+
+    template <typename ArgsT>
+    return_type post_event(const UserEventT type, ArgsT&& args) noexcept {
+        return post_mail(type, args_type { std::forward<ArgsT>(args) });
+    }
+
+    return_type post_event(const UserEventT type) noexcept {
+        return post_mail(type, args_type {});
+    }
+};
+
+} // inline namespace typed_event_loop
+
+} // namespace cun
+
+#endif // ndef TYPED_EVENT_LOOP_HPP_INCLUDED
@@ -25,24 +25,34 @@ VPATH            := $(test-dir)
 include-dirs     := $(addprefix -I ,$(include-core-dir) $(include-hosted-dir) $(machdep-logger-dir) $(VPATH) .)
 
 target-name      := test_binary_writer \
+                    test_bounded_mailbox \
                     test_byte_packer \
                     test_byteorder \
                     test_circular_buffer \
                     test_cstrutil \
+                    test_enum_table \
+                    test_epoll_event_loop \
                     test_event_loop \
+                    test_event_loop_pool \
+                    test_inline_any \
                     test_logger \
                     test_mailbox \
                     test_misc \
                     test_mockable \
                     test_mockout \
                     test_object_pool \
+                    test_priority_mailbox \
                     test_repeat_call \
                     test_sequtil \
+                    test_sharded_mailbox \
                     test_sleep \
                     test_soft_timer \
                     test_strutil \
                     test_system_tick \
-                    test_time_measuring
+                    test_time_measuring \
+                    test_timer_service \
+                    test_timing_wheel \
+                    test_typed_event_loop
 
 lib-object-files := 
 
@@ -0,0 +1,201 @@
+﻿// -*- coding: utf-8-with-signature-dos -*-
+// vim:fileencoding=utf-8:ff=dos
+//
+// Test code: Bounded mailbox.
+
+// C++ standard library
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+// C++ user library
+#include "bounded_mailbox.hpp"
+#include "system_tick.hpp"
+#include "unittest.hpp"
+
+int main()
+{
+    // C++ standard library
+    using namespace std::literals::chrono_literals;
+    using std::string;
+    using std::uint32_t;
+
+    // C++ user library
+    namespace system_tick = cun::system_tick;
+    using cun::BoundedMailbox;
+
+    auto ut = CUN_UNITTEST_MAKE();
+
+    CUN_UNITTEST_TITLE(ut, "Test code: Bounded mailbox.");
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_EXEC(ut, BoundedMailbox<string, 4> mbox);
+    CUN_UNITTEST_EXEC(ut, string val);
+    CUN_UNITTEST_EXEC(ut, std::chrono::milliseconds::rep t1, t2);
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "default parameter check");
+    CUN_UNITTEST_EVAL(ut, mbox.empty());
+    CUN_UNITTEST_EVAL(ut, !mbox.full());
+    CUN_UNITTEST_EVAL(ut, mbox.max_size() == 4);
+    CUN_UNITTEST_EVAL(ut, mbox.size() == 0);
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_EVAL(ut, val.empty());
+    CUN_UNITTEST_EXEC(ut, t1 = system_tick::millis());
+    CUN_UNITTEST_EVAL(ut, !mbox.pop(val, 100ms));
+    CUN_UNITTEST_EXEC(ut, t2 = system_tick::millis());
+    CUN_UNITTEST_EVAL(ut, t2 - t1 >= 100);
+    CUN_UNITTEST_EVAL(ut, val.empty());
+    CUN_UNITTEST_EVAL(ut, !mbox.try_pop(val));
+    CUN_UNITTEST_EVAL(ut, val.empty());
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "push data");
+    CUN_UNITTEST_EXEC(ut, string s1 { "1" });
+    CUN_UNITTEST_EXEC(ut, mbox.push(s1));
+    CUN_UNITTEST_EVAL(ut, !mbox.empty());
+    CUN_UNITTEST_EVAL(ut, mbox.size() == 1);
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_EXEC(ut, mbox.push(string { "2" }));
+    CUN_UNITTEST_EVAL(ut, mbox.size() == 2);
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_EXEC(ut, string s3 { "3" });
+    CUN_UNITTEST_EXEC(ut, mbox.emplace(s3));
+    CUN_UNITTEST_EXEC(ut, mbox.emplace("4"));
+    CUN_UNITTEST_EVAL(ut, mbox.size() == 4);
+    CUN_UNITTEST_EVAL(ut, mbox.full());
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "push data: mailbox is full");
+    CUN_UNITTEST_EXEC(ut, string s5 { "5" });
+    CUN_UNITTEST_EVAL(ut, !mbox.try_push(s5));
+    CUN_UNITTEST_EVAL(ut, !mbox.try_push(std::move(s5)));
+    CUN_UNITTEST_EVAL(ut, s5 == "5");
+    CUN_UNITTEST_EVAL(ut, mbox.size() == 4);
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "pop data: have some mails");
+    CUN_UNITTEST_EXEC(ut, val = mbox.pop());
+    CUN_UNITTEST_EVAL(ut, mbox.size() == 3);
+    CUN_UNITTEST_EVAL(ut, val == "1");
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_EXEC(ut, mbox.pop(val));
+    CUN_UNITTEST_EVAL(ut, mbox.size() == 2);
+    CUN_UNITTEST_EVAL(ut, val == "2");
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_EXEC(ut, t1 = system_tick::millis());
+    CUN_UNITTEST_EVAL(ut, mbox.pop(val, 100ms));
+    CUN_UNITTEST_EXEC(ut, t2 = system_tick::millis());
+    CUN_UNITTEST_EVAL(ut, t2 - t1 < 100);
+    CUN_UNITTEST_EVAL(ut, mbox.size() == 1);
+    CUN_UNITTEST_EVAL(ut, val == "3");
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_EVAL(ut, mbox.try_pop(val));
+    CUN_UNITTEST_EVAL(ut, mbox.empty());
+    CUN_UNITTEST_EVAL(ut, val == "4");
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "pop data: have no mail");
+    CUN_UNITTEST_EXEC(ut, val.clear());
+    CUN_UNITTEST_EXEC(ut, t1 = system_tick::millis());
+    CUN_UNITTEST_EVAL(ut, !mbox.pop(val, 100ms));
+    CUN_UNITTEST_EXEC(ut, t2 = system_tick::millis());
+    CUN_UNITTEST_EVAL(ut, t2 - t1 >= 100);
+    CUN_UNITTEST_EVAL(ut, val.empty());
+    CUN_UNITTEST_EVAL(ut, !mbox.try_pop(val));
+    CUN_UNITTEST_EVAL(ut, val.empty());
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "clear data");
+    CUN_UNITTEST_EVAL(ut, mbox.try_push("A"));
+    CUN_UNITTEST_EVAL(ut, mbox.try_push("B"));
+    CUN_UNITTEST_EVAL(ut, mbox.try_push("C"));
+    CUN_UNITTEST_EVAL(ut, mbox.size() == 3);
+    CUN_UNITTEST_EXEC(ut, mbox.clear());
+    CUN_UNITTEST_EVAL(ut, mbox.empty());
+    CUN_UNITTEST_EVAL(ut, mbox.size() == 0);
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "multiple producers, single consumer");
+    {
+        constexpr uint32_t NUM_PRODUCERS = 8;
+        constexpr uint32_t NUM_MAILS = 10000;
+
+        CUN_UNITTEST_EXEC(ut, BoundedMailbox<uint32_t, 64> mbox2);
+        CUN_UNITTEST_EXEC(ut, std::vector<std::thread> producers);
+        for (uint32_t i = 0; i < NUM_PRODUCERS; i++) {
+            producers.emplace_back([&mbox2, i]{
+                for (uint32_t n = 0; n < NUM_MAILS; n++) {
+                    mbox2.push(i * NUM_MAILS + n);
+                }
+            });
+        }
+        CUN_UNITTEST_EXEC(ut, std::vector<uint32_t> last(NUM_PRODUCERS, 0));
+        CUN_UNITTEST_EXEC(ut, bool in_order = true);
+        CUN_UNITTEST_EXEC(ut, std::uint64_t sum = 0);
+        for (uint32_t n = 0; n < NUM_PRODUCERS * NUM_MAILS; n++) {
+            const auto v = mbox2.pop();
+            const auto id = v / NUM_MAILS;
+            const auto seq = v % NUM_MAILS + 1;
+            in_order = in_order && (seq > last[id]);
+            last[id] = seq;
+            sum += v;
+        }
+        for (auto&& th : producers) {
+            th.join();
+        }
+        CUN_UNITTEST_EVAL(ut, in_order);
+        CUN_UNITTEST_EVAL(ut, sum == std::uint64_t { NUM_PRODUCERS * NUM_MAILS } * (NUM_PRODUCERS * NUM_MAILS - 1) / 2);
+        CUN_UNITTEST_EVAL(ut, mbox2.empty());
+    }
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "close mailbox");
+    CUN_UNITTEST_EVAL(ut, !mbox.closed());
+    CUN_UNITTEST_EVAL(ut, mbox.push("X"));
+    CUN_UNITTEST_EXEC(ut, mbox.close());
+    CUN_UNITTEST_EVAL(ut, mbox.closed());
+    CUN_UNITTEST_EVAL(ut, !mbox.push("Y"));
+    CUN_UNITTEST_EVAL(ut, !mbox.try_push("Y"));
+    CUN_UNITTEST_EVAL(ut, mbox.size() == 1);
+    CUN_UNITTEST_EVAL(ut, mbox.pop(val));
+    CUN_UNITTEST_EVAL(ut, val == "X");
+    CUN_UNITTEST_EXEC(ut, t1 = system_tick::millis());
+    CUN_UNITTEST_EVAL(ut, !mbox.pop(val));
+    CUN_UNITTEST_EVAL(ut, !mbox.pop(val, 100ms));
+    CUN_UNITTEST_EXEC(ut, t2 = system_tick::millis());
+    CUN_UNITTEST_EVAL(ut, t2 - t1 < 100);
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "close mailbox: wake up waiting consumers");
+    {
+        CUN_UNITTEST_EXEC(ut, BoundedMailbox<int, 2> mbox3);
+        CUN_UNITTEST_EXEC(ut, std::vector<std::thread> consumers);
+        for (int i = 0; i < 4; i++) {
+            consumers.emplace_back([&mbox3]{
+                int v { 0 };
+                while (mbox3.pop(v)) {
+                    /*EMPTY*/
+                }
+            });
+        }
+        CUN_UNITTEST_EXEC(ut, std::this_thread::sleep_for(50ms));
+        CUN_UNITTEST_EXEC(ut, mbox3.close());
+        for (auto&& th : consumers) {
+            th.join();
+        }
+        CUN_UNITTEST_EVAL(ut, mbox3.empty());
+    }
+    CUN_UNITTEST_NL(ut);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,81 @@
+﻿// -*- coding: utf-8-with-signature-dos -*-
+// vim:fileencoding=utf-8:ff=dos
+//
+// Test code: Enum table.
+
+// C++ standard library
+#include <cstdlib>
+#include <utility>
+
+// C++ user library
+#include "enum_table.hpp"
+#include "unittest.hpp"
+
+namespace {
+
+enum class Color {
+    red,
+    green,
+    blue,
+    unknown
+};
+
+int twice(const int n) noexcept
+{
+    return n * 2;
+}
+
+int square(const int n) noexcept
+{
+    return n * n;
+}
+
+} // namespace
+
+int main()
+{
+    // C++ standard library
+    using std::make_pair;
+
+    // C++ user library
+    using cun::EnumTable;
+
+    using Table = EnumTable<Color, int (*)(int), 3>;
+
+    auto ut = CUN_UNITTEST_MAKE();
+
+    CUN_UNITTEST_TITLE(ut, "Test code: Enum table.");
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "default parameter check");
+    CUN_UNITTEST_EXEC(ut, Table table);
+    CUN_UNITTEST_EVAL(ut, table.max_size() == 3);
+    CUN_UNITTEST_EVAL(ut, table.find(Color::red) == table.end());
+    CUN_UNITTEST_EVAL(ut, table.end() - table.begin() == 3);
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "insert and find");
+    CUN_UNITTEST_EVAL(ut, table.insert_or_assign(Color::green, twice));
+    CUN_UNITTEST_EVAL(ut, !table.insert_or_assign(Color::unknown, twice));
+    CUN_UNITTEST_EVAL(ut, table.find(Color::red) == table.end());
+    CUN_UNITTEST_EVAL(ut, table.find(Color::green) != table.end());
+    CUN_UNITTEST_EVAL(ut, table.find(Color::green)->first == Color::green);
+    CUN_UNITTEST_EVAL(ut, table.find(Color::green)->second(3) == 6);
+    CUN_UNITTEST_EVAL(ut, table.find(Color::unknown) == table.end());
+    CUN_UNITTEST_EVAL(ut, table.insert_or_assign(Color::green, square));
+    CUN_UNITTEST_EVAL(ut, table.find(Color::green)->second(3) == 9);
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "constant table");
+    static constexpr Table TABLE {
+        make_pair(Color::red, twice),
+        make_pair(Color::blue, square),
+    };
+    CUN_UNITTEST_EVAL(ut, TABLE.find(Color::red)->second(4) == 8);
+    CUN_UNITTEST_EVAL(ut, TABLE.find(Color::green) == TABLE.end());
+    CUN_UNITTEST_EVAL(ut, TABLE.find(Color::blue)->second(4) == 16);
+    static_assert(TABLE.find(Color::blue) != TABLE.end());
+    CUN_UNITTEST_NL(ut);
+
+    return EXIT_SUCCESS;
+}
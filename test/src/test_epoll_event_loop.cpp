@@ -0,0 +1,204 @@
+﻿// -*- coding: utf-8-with-signature-dos -*-
+// vim:fileencoding=utf-8:ff=dos
+//
+// Test code: Epoll event loop toolbox.
+
+// C++ standard library
+#include <cstdlib>
+
+// C++ user library
+#include "epoll_event_loop.hpp"
+#include "unittest.hpp"
+
+#if defined(__linux__)
+
+// C++ standard library
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <utility>
+
+// POSIX / Linux
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+// C++ standard library
+using std::make_pair;
+
+// C++ user library
+using cun::EpollEventLoop;
+using cun::IoEvent;
+using cun::UnitTest;
+
+enum class EventType {
+    on_readable,
+    on_post,
+    on_sync
+};
+
+struct Context final {
+    std::string received;
+    std::atomic_size_t num_received { 0 };
+    std::thread::id io_thread;
+    std::thread::id post_thread;
+};
+
+using IoLoop = EpollEventLoop<EventType, Context *>;
+
+void wait_for_received(const Context& ctx, const std::size_t expected)
+{
+    for (auto n = ctx.num_received.load(); n < expected; n = ctx.num_received.load()) {
+        ctx.num_received.wait(n);
+    }
+}
+
+bool write_string(const int fd, const std::string& s)
+{
+    return ::write(fd, s.data(), s.size()) == static_cast<ssize_t>(s.size());
+}
+
+/* ---------------------------------------------------------------------- */
+/* Test code: pipes and socketpairs. */
+/* ---------------------------------------------------------------------- */
+
+void test_readiness(UnitTest& ut)
+{
+    CUN_UNITTEST_TITLE(ut, "Test code: Epoll event loop toolbox - pipes and socketpairs.");
+    CUN_UNITTEST_NL(ut);
+
+    using namespace std::chrono_literals;
+
+    IoLoop::event_entry entry {
+        make_pair(EventType::on_readable, [](Context *ctx, std::any& args, std::any&) {
+            const auto ev = std::any_cast<IoEvent>(args);
+            char buf[64];
+            const auto n = ::read(ev.fd, buf, sizeof(buf));
+            if (n <= 0) {
+                return false;
+            }
+            ctx->io_thread = std::this_thread::get_id();
+            ctx->received.append(buf, static_cast<std::size_t>(n));
+            ctx->num_received += static_cast<std::size_t>(n);
+            ctx->num_received.notify_all();
+            return true;
+        }),
+        make_pair(EventType::on_post, [](Context *ctx, std::any&, std::any&) {
+            ctx->post_thread = std::this_thread::get_id();
+            return true;
+        }),
+        make_pair(EventType::on_sync, [](Context *, std::any&, std::any&) {
+            return true;
+        }),
+    };
+
+    int pipe_fds[2];
+    int socket_fds[2];
+    CUN_UNITTEST_EVAL(ut, ::pipe2(pipe_fds, O_NONBLOCK | O_CLOEXEC) == 0);
+    CUN_UNITTEST_EVAL(ut, ::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, socket_fds) == 0);
+    {
+        CUN_UNITTEST_EXEC(ut, Context context);
+        CUN_UNITTEST_EXEC(ut, IoLoop el(entry, &context));
+        CUN_UNITTEST_NL(ut);
+
+        CUN_UNITTEST_EVAL(ut, el.add_fd(pipe_fds[0], EPOLLIN, EventType::on_readable));
+        CUN_UNITTEST_EVAL(ut, !el.add_fd(pipe_fds[0], EPOLLIN, EventType::on_readable));
+        CUN_UNITTEST_EVAL(ut, write_string(pipe_fds[1], "abc"));
+        CUN_UNITTEST_EXEC(ut, wait_for_received(context, 3));
+        CUN_UNITTEST_EVAL(ut, el.post_event(EventType::on_post));
+        CUN_UNITTEST_EVAL(ut, el.send_event(EventType::on_sync));
+        CUN_UNITTEST_EVAL(ut, context.received == "abc");
+        CUN_UNITTEST_EVAL(ut, context.io_thread == context.post_thread);
+        CUN_UNITTEST_EVAL(ut, context.io_thread != std::this_thread::get_id());
+        CUN_UNITTEST_NL(ut);
+
+        CUN_UNITTEST_EVAL(ut, el.add_fd(socket_fds[0], EPOLLIN, EventType::on_readable));
+        CUN_UNITTEST_EVAL(ut, write_string(socket_fds[1], "de"));
+        CUN_UNITTEST_EXEC(ut, wait_for_received(context, 5));
+        CUN_UNITTEST_EVAL(ut, el.send_event(EventType::on_sync));
+        CUN_UNITTEST_EVAL(ut, context.received == "abcde");
+        CUN_UNITTEST_NL(ut);
+
+        CUN_UNITTEST_EVAL(ut, el.remove_fd(pipe_fds[0]));
+        CUN_UNITTEST_EVAL(ut, !el.remove_fd(pipe_fds[0]));
+        CUN_UNITTEST_EVAL(ut, write_string(pipe_fds[1], "x"));
+        CUN_UNITTEST_EXEC(ut, std::this_thread::sleep_for(20ms));
+        CUN_UNITTEST_EVAL(ut, el.send_event(EventType::on_sync));
+        CUN_UNITTEST_EVAL(ut, context.received == "abcde");
+        CUN_UNITTEST_EVAL(ut, el.remove_fd(socket_fds[0]));
+        CUN_UNITTEST_NL(ut);
+    }
+    for (const auto fd : { pipe_fds[0], pipe_fds[1], socket_fds[0], socket_fds[1] }) {
+        (void) ::close(fd);
+    }
+
+    CUN_UNITTEST_RESET(ut);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Test code: many posted events. */
+/* ---------------------------------------------------------------------- */
+
+void test_many_events(UnitTest& ut)
+{
+    CUN_UNITTEST_TITLE(ut, "Test code: Epoll event loop toolbox - many posted events.");
+    CUN_UNITTEST_NL(ut);
+
+    static constexpr int NUM_EVENTS { 10000 };
+
+    IoLoop::event_entry entry {
+        make_pair(EventType::on_post, [](Context *ctx, std::any& args, std::any&) {
+            ctx->received += static_cast<char>('0' + std::any_cast<int>(args) % 10);
+            return true;
+        }),
+        make_pair(EventType::on_sync, [](Context *ctx, std::any&, std::any& results) {
+            *std::any_cast<std::size_t *>(results) = ctx->received.size();
+            return true;
+        }),
+    };
+
+    CUN_UNITTEST_EXEC(ut, Context context);
+    {
+        CUN_UNITTEST_EXEC(ut, IoLoop el(entry, &context));
+        CUN_UNITTEST_EXEC(ut, std::size_t size = 0);
+        for (auto i = 0; i < NUM_EVENTS; i++) {
+            (void) el.post_event(EventType::on_post, i);
+        }
+        CUN_UNITTEST_EVAL(ut, el.send_event(EventType::on_sync, 0, &size));
+        CUN_UNITTEST_EVAL(ut, size == NUM_EVENTS);
+        for (auto i = 0; i < NUM_EVENTS; i++) {
+            (void) el.post_event(EventType::on_post, i);
+        }
+    }
+    // The mails queued before the destruction are handled.
+    CUN_UNITTEST_EVAL(ut, context.received.size() == NUM_EVENTS * 2);
+    CUN_UNITTEST_EVAL(ut, context.received.substr(0, 12) == "012345678901");
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_RESET(ut);
+}
+
+} // namespace
+
+#endif // defined(__linux__)
+
+/* ---------------------------------------------------------------------- */
+/* Main routine. */
+/* ---------------------------------------------------------------------- */
+
+int main()
+{
+    auto ut = CUN_UNITTEST_MAKE();
+
+#if defined(__linux__)
+    test_readiness(ut);
+    test_many_events(ut);
+#else
+    (void) ut;
+#endif
+
+    return EXIT_SUCCESS;
+}
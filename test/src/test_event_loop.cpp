@@ -4,11 +4,16 @@
 // Test code: Event loop toolbox.
 
 // C++ standard library
+#include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <cstdlib>
+#include <map>
 #include <memory>
 #include <sstream>
+#include <thread>
 #include <utility>
+#include <vector>
 
 // C++ user library
 #include "event_loop.hpp"
@@ -22,6 +27,7 @@ using std::ostringstream;
 using std::uintptr_t;
 
 // C++ user library
+using cun::DetachedTask;
 using cun::EventLoop;
 using cun::UnitTest;
 
@@ -437,6 +443,587 @@ void test_argument_type(UnitTest& ut)
     CUN_UNITTEST_RESET(ut);
 }
 
+/* ---------------------------------------------------------------------- */
+/* Test code: destroy with pending events. */
+/* ---------------------------------------------------------------------- */
+
+void test_pending_events(UnitTest& ut)
+{
+    CUN_UNITTEST_TITLE(ut, "Test code: Event loop toolbox - destroy with pending events.");
+    CUN_UNITTEST_NL(ut);
+
+    EventLoop<EventType, Context *>::event_entry entry {
+        make_pair(EventType::on_test_1, [](Context *ctx, std::any&, std::any&) {
+            ctx->count++;
+            return true;
+        }),
+    };
+
+    CUN_UNITTEST_EXEC(ut, Context context);
+    {
+        CUN_UNITTEST_EXEC(ut, EventLoop<EventType, Context *> el(entry, &context));
+        for (int i = 0; i < 100; i++) {
+            (void) el.post_event(EventType::on_test_1);
+        }
+    }
+    CUN_UNITTEST_EVAL(ut, context.count == 100);
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_RESET(ut);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Test code: dense dispatch table. */
+/* ---------------------------------------------------------------------- */
+
+void test_enum_table(UnitTest& ut)
+{
+    CUN_UNITTEST_TITLE(ut, "Test code: Event loop toolbox - dense dispatch table.");
+    CUN_UNITTEST_NL(ut);
+
+    using DenseEventLoop = EventLoop<EventType, Context *, cun::ReturnTraits<bool>, cun::EnumTableOf<4>::type>;
+
+    DenseEventLoop::event_entry entry {
+        make_pair(EventType::on_test_1, test_with_ctx_rawptr_1),
+        make_pair(EventType::on_test_2, test_with_ctx_rawptr_2),
+    };
+
+    CUN_UNITTEST_EXEC(ut, Context context);
+    CUN_UNITTEST_EXEC(ut, DenseEventLoop el { entry, &context });
+    CUN_UNITTEST_EXEC(ut, auto results = reinterpret_cast<void *>(static_cast<uintptr_t>(0xDEADBEEF)));
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_EVAL(ut, el.post_event(EventType::on_test_1, &ut));
+    CUN_UNITTEST_EVAL(ut, el.send_event(EventType::on_test_2, &ut, results));
+    CUN_UNITTEST_EVAL(ut, !el.send_event(EventType::on_test_3, &ut, results));
+    CUN_UNITTEST_EVAL(ut, context.count == 2);
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_RESET(ut);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Test code: send events from multiple threads. */
+/* ---------------------------------------------------------------------- */
+
+void test_concurrent_send(UnitTest& ut)
+{
+    CUN_UNITTEST_TITLE(ut, "Test code: Event loop toolbox - send events from multiple threads.");
+    CUN_UNITTEST_NL(ut);
+
+    EventLoop<EventType, Context *>::event_entry entry {
+        make_pair(EventType::on_test_1, [](Context *ctx, std::any& args, std::any& results) {
+            ctx->count++;
+            *std::any_cast<int32_t *>(results) = std::any_cast<int32_t>(args) * 2;
+            return true;
+        }),
+    };
+
+    CUN_UNITTEST_EXEC(ut, Context context);
+    {
+        CUN_UNITTEST_EXEC(ut, EventLoop<EventType, Context *> el(entry, &context));
+        CUN_UNITTEST_EXEC(ut, std::vector<std::thread> senders);
+        CUN_UNITTEST_EXEC(ut, std::vector<int> num_ok(4, 0));
+        for (int i = 0; i < 4; i++) {
+            senders.emplace_back([&el, &num_ok, i]{
+                for (int32_t n = 0; n < 1000; n++) {
+                    int32_t result = -1;
+                    if (el.send_event(EventType::on_test_1, n, &result) && (result == n * 2)) {
+                        num_ok[i]++;
+                    }
+                }
+            });
+        }
+        for (auto&& th : senders) {
+            th.join();
+        }
+        CUN_UNITTEST_EVAL(ut, (num_ok == std::vector<int> { 1000, 1000, 1000, 1000 }));
+    }
+    CUN_UNITTEST_EVAL(ut, context.count == 4000);
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_RESET(ut);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Test code: send / post events from a handler. */
+/* ---------------------------------------------------------------------- */
+
+struct ReentrantContext final {
+    EventLoop<EventType, ReentrantContext *> *loop { nullptr };
+    std::vector<int> order;
+};
+
+void test_reentrant(UnitTest& ut)
+{
+    CUN_UNITTEST_TITLE(ut, "Test code: Event loop toolbox - send / post events from a handler.");
+    CUN_UNITTEST_NL(ut);
+
+    EventLoop<EventType, ReentrantContext *>::event_entry entry {
+        make_pair(EventType::on_test_1, [](ReentrantContext *ctx, std::any&, std::any&) {
+            ctx->order.push_back(1);
+            // Deferred until this handler returns.
+            const auto posted = ctx->loop->post_event(EventType::on_test_3);
+            // Handled inline instead of deadlocking.
+            int32_t result = 0;
+            const auto sent = ctx->loop->send_event(EventType::on_test_2, int32_t { 21 }, &result);
+            ctx->order.push_back(result);
+            return posted && sent;
+        }),
+        make_pair(EventType::on_test_2, [](ReentrantContext *ctx, std::any& args, std::any& results) {
+            ctx->order.push_back(2);
+            *std::any_cast<int32_t *>(results) = std::any_cast<int32_t>(args) * 2;
+            return true;
+        }),
+        make_pair(EventType::on_test_3, [](ReentrantContext *ctx, std::any&, std::any&) {
+            ctx->order.push_back(3);
+            return true;
+        }),
+        make_pair(EventType::on_destroy, [](ReentrantContext *ctx, std::any&, std::any&) {
+            ctx->order.push_back(4);
+            return true;
+        }),
+    };
+
+    CUN_UNITTEST_EXEC(ut, ReentrantContext context);
+    {
+        CUN_UNITTEST_EXEC(ut, EventLoop<EventType, ReentrantContext *> el(entry, &context));
+        CUN_UNITTEST_EXEC(ut, context.loop = &el);
+        CUN_UNITTEST_EVAL(ut, el.send_event(EventType::on_test_1));
+        CUN_UNITTEST_EVAL(ut, el.send_event(EventType::on_destroy));
+    }
+    CUN_UNITTEST_EVAL(ut, (context.order == std::vector<int> { 1, 2, 42, 3, 4 }));
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_RESET(ut);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Test code: await events from coroutines. */
+/* ---------------------------------------------------------------------- */
+
+using CoroutineLoop = EventLoop<EventType, struct CoroutineContext *>;
+
+struct CoroutineContext final {
+    CoroutineLoop *backend { nullptr };
+    std::thread::id front_thread;
+    std::atomic_int num_resumed_on_front { 0 };
+    std::atomic_int sum { 0 };
+    std::atomic_int num_done { 0 };
+};
+
+DetachedTask await_backend(CoroutineContext *ctx, const int32_t value)
+{
+    for (auto i = 0; i < 2; i++) {
+        int32_t result = 0;
+        if (co_await ctx->backend->async_send(EventType::on_test_2, value, &result)) {
+            ctx->sum += result;
+        }
+        if (std::this_thread::get_id() == ctx->front_thread) {
+            ctx->num_resumed_on_front++;
+        }
+    }
+    ctx->num_done++;
+    ctx->num_done.notify_all();
+}
+
+void test_coroutine(UnitTest& ut)
+{
+    CUN_UNITTEST_TITLE(ut, "Test code: Event loop toolbox - await events from coroutines.");
+    CUN_UNITTEST_NL(ut);
+
+    static constexpr int NUM_TASKS { 100 };
+
+    CoroutineLoop::event_entry front_entry {
+        make_pair(EventType::on_test_1, [](CoroutineContext *ctx, std::any& args, std::any&) {
+            ctx->front_thread = std::this_thread::get_id();
+            (void) await_backend(ctx, std::any_cast<int32_t>(args));
+            return true;
+        }),
+    };
+    CoroutineLoop::event_entry backend_entry {
+        make_pair(EventType::on_test_2, [](CoroutineContext *, std::any& args, std::any& results) {
+            *std::any_cast<int32_t *>(results) = std::any_cast<int32_t>(args) * 2;
+            return true;
+        }),
+    };
+
+    CUN_UNITTEST_EXEC(ut, CoroutineContext context);
+    {
+        // The loop which resumes coroutines must outlive the loop which completes them.
+        CUN_UNITTEST_EXEC(ut, CoroutineLoop front(front_entry, &context));
+        CUN_UNITTEST_EXEC(ut, CoroutineLoop backend(backend_entry, &context));
+        CUN_UNITTEST_EXEC(ut, context.backend = &backend);
+        for (auto i = 0; i < NUM_TASKS; i++) {
+            (void) front.post_event(EventType::on_test_1, int32_t { i });
+        }
+        for (auto n = context.num_done.load(); n < NUM_TASKS; n = context.num_done.load()) {
+            context.num_done.wait(n);
+        }
+        CUN_UNITTEST_EVAL(ut, context.num_resumed_on_front == NUM_TASKS * 2);
+        CUN_UNITTEST_EVAL(ut, context.sum == (NUM_TASKS - 1) * NUM_TASKS * 2);
+    }
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_RESET(ut);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Test code: post events with timers. */
+/* ---------------------------------------------------------------------- */
+
+struct TimerContext final {
+    std::vector<int> order;
+    std::atomic_int num_fired { 0 };
+    std::atomic_int num_ticks { 0 };
+};
+
+void wait_for_count(const std::atomic_int& count, const int expected)
+{
+    for (auto n = count.load(); n < expected; n = count.load()) {
+        count.wait(n);
+    }
+}
+
+void test_timer(UnitTest& ut)
+{
+    CUN_UNITTEST_TITLE(ut, "Test code: Event loop toolbox - post events with timers.");
+    CUN_UNITTEST_NL(ut);
+
+    using namespace std::chrono_literals;
+    using TimerLoop = EventLoop<EventType, TimerContext *>;
+
+    static constexpr int NUM_TIMERS { 1000 };
+
+    TimerLoop::event_entry entry {
+        make_pair(EventType::on_test_1, [](TimerContext *ctx, std::any& args, std::any&) {
+            ctx->order.push_back(std::any_cast<int>(args));
+            ctx->num_fired++;
+            ctx->num_fired.notify_all();
+            return true;
+        }),
+        make_pair(EventType::on_test_2, [](TimerContext *ctx, std::any&, std::any&) {
+            ctx->num_ticks++;
+            ctx->num_ticks.notify_all();
+            return true;
+        }),
+        make_pair(EventType::on_test_3, [](TimerContext *, std::any&, std::any&) {
+            return true;
+        }),
+    };
+
+    CUN_UNITTEST_EXEC(ut, TimerContext context);
+    CUN_UNITTEST_EXEC(ut, TimerLoop el(entry, &context));
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_EVAL(ut, el.post_event_after(60ms, EventType::on_test_1, 3) != 0);
+    CUN_UNITTEST_EVAL(ut, el.post_event_after(20ms, EventType::on_test_1, 1) != 0);
+    CUN_UNITTEST_EVAL(ut, el.post_event_at(TimerLoop::clock_type::now() + 40ms, EventType::on_test_1, 2) != 0);
+    // Far enough not to fire before cancel_timer, however late this thread is.
+    CUN_UNITTEST_EXEC(ut, const auto cancelled = el.post_event_after(1h, EventType::on_test_1, 99));
+    CUN_UNITTEST_EVAL(ut, el.cancel_timer(cancelled));
+    CUN_UNITTEST_EVAL(ut, !el.cancel_timer(cancelled));
+    CUN_UNITTEST_EXEC(ut, wait_for_count(context.num_fired, 3));
+    CUN_UNITTEST_EVAL(ut, el.send_event(EventType::on_test_3));
+    CUN_UNITTEST_EVAL(ut, (context.order == std::vector<int> { 1, 2, 3 }));
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_EXEC(ut, const auto periodic = el.post_event_every(5ms, EventType::on_test_2));
+    CUN_UNITTEST_EXEC(ut, wait_for_count(context.num_ticks, 5));
+    CUN_UNITTEST_EVAL(ut, el.cancel_timer(periodic));
+    CUN_UNITTEST_EVAL(ut, el.send_event(EventType::on_test_3));
+    CUN_UNITTEST_EXEC(ut, const auto num_ticks = context.num_ticks.load());
+    CUN_UNITTEST_EXEC(ut, std::this_thread::sleep_for(30ms));
+    CUN_UNITTEST_EVAL(ut, context.num_ticks == num_ticks);
+    CUN_UNITTEST_NL(ut);
+
+    for (auto i = 0; i < NUM_TIMERS; i++) {
+        (void) el.post_event_after(std::chrono::milliseconds { i % 20 }, EventType::on_test_1, i);
+    }
+    CUN_UNITTEST_EXEC(ut, wait_for_count(context.num_fired, 3 + NUM_TIMERS));
+    CUN_UNITTEST_EVAL(ut, el.send_event(EventType::on_test_3));
+    CUN_UNITTEST_EVAL(ut, context.order.size() == 3 + NUM_TIMERS);
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_RESET(ut);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Test code: metrics per event type. */
+/* ---------------------------------------------------------------------- */
+
+void test_metrics(UnitTest& ut)
+{
+    CUN_UNITTEST_TITLE(ut, "Test code: Event loop toolbox - metrics per event type.");
+    CUN_UNITTEST_NL(ut);
+
+    using namespace std::chrono_literals;
+    using MeasuredLoop = EventLoop<EventType, void *, cun::ReturnTraits<bool>, std::map, true>;
+
+    const auto sum_of = [](const std::uint64_t (&histogram)[cun::EventMetrics::NUM_BUCKETS]) {
+        std::uint64_t sum { 0 };
+        for (const auto n : histogram) {
+            sum += n;
+        }
+        return sum;
+    };
+
+    MeasuredLoop::event_entry entry {
+        make_pair(EventType::on_test_1, [](void *, std::any&, std::any&) {
+            std::this_thread::sleep_for(10ms);
+            return true;
+        }),
+        make_pair(EventType::on_test_2, [](void *, std::any&, std::any&) {
+            return true;
+        }),
+    };
+
+    CUN_UNITTEST_EXEC(ut, MeasuredLoop el { entry });
+    CUN_UNITTEST_EVAL(ut, el.metrics().empty());
+    for (auto i = 0; i < 5; i++) {
+        (void) el.post_event(EventType::on_test_1);
+    }
+    CUN_UNITTEST_EVAL(ut, el.send_event(EventType::on_test_2));
+    CUN_UNITTEST_EVAL(ut, el.send_event(EventType::on_test_2));
+    CUN_UNITTEST_EVAL(ut, !el.send_event(EventType::on_test_3));
+    CUN_UNITTEST_EXEC(ut, const auto metrics = el.metrics());
+    CUN_UNITTEST_EVAL(ut, metrics.size() == 3);
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_EXEC(ut, const auto& slow = metrics.at(EventType::on_test_1));
+    CUN_UNITTEST_EVAL(ut, slow.num_events == 5);
+    CUN_UNITTEST_EVAL(ut, slow.run.num_data == 5);
+    CUN_UNITTEST_EVAL(ut, slow.run.min >= 10ms);
+    CUN_UNITTEST_EVAL(ut, slow.wait.max >= 40ms);
+    CUN_UNITTEST_EVAL(ut, sum_of(slow.run_histogram) == 5);
+    CUN_UNITTEST_EVAL(ut, sum_of(slow.wait_histogram) == 5);
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_EXEC(ut, const auto& fast = metrics.at(EventType::on_test_2));
+    CUN_UNITTEST_EVAL(ut, fast.num_events == 2);
+    // Relative to the slow handler, not to a fixed limit.
+    CUN_UNITTEST_EVAL(ut, fast.run.max < slow.run.min);
+    CUN_UNITTEST_EVAL(ut, fast.wait.max >= 40ms);
+    CUN_UNITTEST_EVAL(ut, metrics.at(EventType::on_test_3).num_events == 1);
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_EXEC(ut, el.reset_metrics());
+    CUN_UNITTEST_EVAL(ut, el.metrics().empty());
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_RESET(ut);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Test code: limit the mailbox. */
+/* ---------------------------------------------------------------------- */
+
+struct BackpressureContext final {
+    std::atomic_bool entered { false };
+    std::atomic_bool released { false };
+    std::vector<int> received;
+};
+
+using BackpressureLoop = EventLoop<EventType, BackpressureContext *>;
+
+// Blocks the loop in a handler, so that posted events stay in the mailbox.
+void stall(BackpressureLoop& el, BackpressureContext& ctx)
+{
+    ctx.entered = false;
+    ctx.released = false;
+    (void) el.post_event(EventType::on_destroy);
+    ctx.entered.wait(false);
+}
+
+void resume(BackpressureLoop& el, BackpressureContext& ctx)
+{
+    ctx.released = true;
+    ctx.released.notify_all();
+    (void) el.send_event(EventType::on_test_1);
+}
+
+void test_backpressure(UnitTest& ut)
+{
+    CUN_UNITTEST_TITLE(ut, "Test code: Event loop toolbox - limit the mailbox.");
+    CUN_UNITTEST_NL(ut);
+
+    using namespace std::chrono_literals;
+    using cun::OverflowPolicy;
+
+    BackpressureLoop::event_entry entry {
+        make_pair(EventType::on_test_1, [](BackpressureContext *, std::any&, std::any&) {
+            return true;
+        }),
+        make_pair(EventType::on_test_2, [](BackpressureContext *ctx, std::any& args, std::any&) {
+            ctx->received.push_back(std::any_cast<int>(args));
+            return true;
+        }),
+        make_pair(EventType::on_test_3, [](BackpressureContext *ctx, std::any& args, std::any&) {
+            ctx->received.push_back(std::any_cast<int>(args));
+            return true;
+        }),
+        make_pair(EventType::on_destroy, [](BackpressureContext *ctx, std::any&, std::any&) {
+            ctx->entered = true;
+            ctx->entered.notify_all();
+            ctx->released.wait(false);
+            return true;
+        }),
+    };
+
+    CUN_UNITTEST_EXEC(ut, BackpressureContext context);
+    CUN_UNITTEST_EXEC(ut, BackpressureLoop el(entry, &context));
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "fail");
+    CUN_UNITTEST_EXEC(ut, el.set_capacity(2, OverflowPolicy::fail));
+    CUN_UNITTEST_EXEC(ut, stall(el, context));
+    CUN_UNITTEST_EVAL(ut, el.post_event(EventType::on_test_2, 1));
+    CUN_UNITTEST_EVAL(ut, el.post_event(EventType::on_test_2, 2));
+    CUN_UNITTEST_EVAL(ut, !el.post_event(EventType::on_test_2, 3));
+    CUN_UNITTEST_EXEC(ut, resume(el, context));
+    CUN_UNITTEST_EVAL(ut, (context.received == std::vector<int> { 1, 2 }));
+    CUN_UNITTEST_EXEC(ut, context.received.clear());
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "drop oldest");
+    CUN_UNITTEST_EXEC(ut, el.set_capacity(2, OverflowPolicy::drop_oldest));
+    CUN_UNITTEST_EXEC(ut, stall(el, context));
+    CUN_UNITTEST_EVAL(ut, el.post_event(EventType::on_test_2, 1));
+    CUN_UNITTEST_EVAL(ut, el.post_event(EventType::on_test_2, 2));
+    CUN_UNITTEST_EVAL(ut, el.post_event(EventType::on_test_3, 3));
+    CUN_UNITTEST_EXEC(ut, resume(el, context));
+    CUN_UNITTEST_EVAL(ut, (context.received == std::vector<int> { 2, 3 }));
+    CUN_UNITTEST_EXEC(ut, context.received.clear());
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "coalesce");
+    CUN_UNITTEST_EXEC(ut, el.set_capacity(2, OverflowPolicy::coalesce));
+    CUN_UNITTEST_EXEC(ut, stall(el, context));
+    CUN_UNITTEST_EVAL(ut, el.post_event(EventType::on_test_2, 1));
+    CUN_UNITTEST_EVAL(ut, el.post_event(EventType::on_test_3, 10));
+    CUN_UNITTEST_EVAL(ut, el.post_event(EventType::on_test_2, 2));
+    CUN_UNITTEST_EVAL(ut, el.post_event(EventType::on_test_2, 3));
+    CUN_UNITTEST_EVAL(ut, !el.post_event(EventType::on_test_1));
+    CUN_UNITTEST_EXEC(ut, resume(el, context));
+    CUN_UNITTEST_EVAL(ut, (context.received == std::vector<int> { 3, 10 }));
+    CUN_UNITTEST_EXEC(ut, context.received.clear());
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "block");
+    CUN_UNITTEST_EXEC(ut, el.set_capacity(2, OverflowPolicy::block));
+    CUN_UNITTEST_EXEC(ut, stall(el, context));
+    CUN_UNITTEST_EVAL(ut, el.post_event(EventType::on_test_2, 1));
+    CUN_UNITTEST_EVAL(ut, el.post_event(EventType::on_test_2, 2));
+    CUN_UNITTEST_EVAL(ut, !el.try_post_event(EventType::on_test_2, 99));
+    CUN_UNITTEST_EXEC(ut, std::atomic_bool posted { false });
+    std::thread producer([&el, &posted]{
+        posted = el.post_event(EventType::on_test_2, 3);
+    });
+    CUN_UNITTEST_EXEC(ut, std::this_thread::sleep_for(50ms));
+    CUN_UNITTEST_EVAL(ut, !posted);
+    CUN_UNITTEST_EXEC(ut, resume(el, context));
+    CUN_UNITTEST_EXEC(ut, producer.join());
+    CUN_UNITTEST_EVAL(ut, posted);
+    CUN_UNITTEST_EVAL(ut, el.send_event(EventType::on_test_1));
+    CUN_UNITTEST_EVAL(ut, (context.received == std::vector<int> { 1, 2, 3 }));
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_RESET(ut);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Test code: coalesce events of a type. */
+/* ---------------------------------------------------------------------- */
+
+void test_coalescing(UnitTest& ut)
+{
+    CUN_UNITTEST_TITLE(ut, "Test code: Event loop toolbox - coalesce events of a type.");
+    CUN_UNITTEST_NL(ut);
+
+    using cun::OverflowPolicy;
+
+    BackpressureLoop::event_entry entry {
+        make_pair(EventType::on_test_1, [](BackpressureContext *, std::any&, std::any&) {
+            return true;
+        }),
+        make_pair(EventType::on_test_2, [](BackpressureContext *ctx, std::any& args, std::any&) {
+            ctx->received.push_back(std::any_cast<int>(args));
+            return true;
+        }),
+        make_pair(EventType::on_test_3, [](BackpressureContext *ctx, std::any& args, std::any&) {
+            ctx->received.push_back(std::any_cast<int>(args));
+            return true;
+        }),
+        make_pair(EventType::on_destroy, [](BackpressureContext *ctx, std::any&, std::any&) {
+            ctx->entered = true;
+            ctx->entered.notify_all();
+            ctx->released.wait(false);
+            return true;
+        }),
+    };
+
+    CUN_UNITTEST_EXEC(ut, BackpressureContext context);
+    CUN_UNITTEST_EXEC(ut, BackpressureLoop el(entry, &context));
+    CUN_UNITTEST_EXEC(ut, el.set_coalescing(EventType::on_test_2));
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_EXEC(ut, stall(el, context));
+    CUN_UNITTEST_EVAL(ut, el.post_event(EventType::on_test_2, 1));
+    CUN_UNITTEST_EVAL(ut, el.post_event(EventType::on_test_3, 10));
+    CUN_UNITTEST_EVAL(ut, el.post_event(EventType::on_test_2, 2));
+    CUN_UNITTEST_EVAL(ut, el.post_event(EventType::on_test_3, 20));
+    CUN_UNITTEST_EVAL(ut, el.post_event(EventType::on_test_2, 3));
+    CUN_UNITTEST_EXEC(ut, resume(el, context));
+    CUN_UNITTEST_EVAL(ut, (context.received == std::vector<int> { 3, 10, 20 }));
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_COMMENT(ut, "Not limited by the capacity");
+    CUN_UNITTEST_EXEC(ut, el.set_capacity(1, OverflowPolicy::fail));
+    CUN_UNITTEST_EXEC(ut, stall(el, context));
+    CUN_UNITTEST_EVAL(ut, el.post_event(EventType::on_test_3, 30));
+    CUN_UNITTEST_EVAL(ut, !el.post_event(EventType::on_test_3, 40));
+    CUN_UNITTEST_EVAL(ut, el.post_event(EventType::on_test_2, 4));
+    CUN_UNITTEST_EVAL(ut, el.post_event(EventType::on_test_2, 5));
+    CUN_UNITTEST_EXEC(ut, resume(el, context));
+    CUN_UNITTEST_EVAL(ut, (context.received == std::vector<int> { 3, 10, 20, 30, 5 }));
+    CUN_UNITTEST_EXEC(ut, el.set_capacity(0));
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_COMMENT(ut, "Not dropped by drop_oldest");
+    CUN_UNITTEST_EXEC(ut, context.received.clear());
+    CUN_UNITTEST_EXEC(ut, el.set_capacity(2, OverflowPolicy::drop_oldest));
+    CUN_UNITTEST_EXEC(ut, stall(el, context));
+    CUN_UNITTEST_EVAL(ut, el.post_event(EventType::on_test_2, 8));
+    CUN_UNITTEST_EVAL(ut, el.post_event(EventType::on_test_3, 50));
+    CUN_UNITTEST_EVAL(ut, el.post_event(EventType::on_test_3, 60));
+    CUN_UNITTEST_EXEC(ut, resume(el, context));
+    CUN_UNITTEST_EVAL(ut, (context.received == std::vector<int> { 8, 60 }));
+    CUN_UNITTEST_EXEC(ut, stall(el, context));
+    CUN_UNITTEST_EVAL(ut, el.post_event(EventType::on_test_2, 9));
+    CUN_UNITTEST_EXEC(ut, resume(el, context));
+    CUN_UNITTEST_EVAL(ut, (context.received == std::vector<int> { 8, 60, 9 }));
+    CUN_UNITTEST_EXEC(ut, el.set_capacity(0));
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_COMMENT(ut, "Disable coalescing");
+    CUN_UNITTEST_EXEC(ut, context.received.clear());
+    CUN_UNITTEST_EXEC(ut, stall(el, context));
+    CUN_UNITTEST_EVAL(ut, el.post_event(EventType::on_test_2, 11));
+    CUN_UNITTEST_EVAL(ut, !el.set_coalescing(EventType::on_test_2, false));
+    CUN_UNITTEST_EXEC(ut, resume(el, context));
+    CUN_UNITTEST_EVAL(ut, (context.received == std::vector<int> { 11 }));
+    CUN_UNITTEST_EVAL(ut, el.set_coalescing(EventType::on_test_2, false));
+    CUN_UNITTEST_EXEC(ut, context.received.clear());
+    CUN_UNITTEST_EXEC(ut, stall(el, context));
+    CUN_UNITTEST_EVAL(ut, el.post_event(EventType::on_test_2, 6));
+    CUN_UNITTEST_EVAL(ut, el.post_event(EventType::on_test_2, 7));
+    CUN_UNITTEST_EXEC(ut, resume(el, context));
+    CUN_UNITTEST_EVAL(ut, (context.received == std::vector<int> { 6, 7 }));
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_RESET(ut);
+}
+
 } // namespace
 
 /* ---------------------------------------------------------------------- */
@@ -453,6 +1040,15 @@ int main()
     test_with_ctx_smartptr(ut);
     test_inherited_class(ut);
     test_argument_type(ut);
+    test_pending_events(ut);
+    test_enum_table(ut);
+    test_concurrent_send(ut);
+    test_reentrant(ut);
+    test_coroutine(ut);
+    test_timer(ut);
+    test_metrics(ut);
+    test_backpressure(ut);
+    test_coalescing(ut);
 
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,234 @@
+﻿// -*- coding: utf-8-with-signature-dos -*-
+// vim:fileencoding=utf-8:ff=dos
+//
+// Test code: Event loop toolbox with multiple worker threads.
+
+// C++ standard library
+#include <any>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// C++ user library
+#include "event_loop_pool.hpp"
+#include "unittest.hpp"
+
+namespace {
+
+// C++ standard library
+using namespace std::literals::chrono_literals;
+using std::make_pair;
+
+// C++ user library
+using cun::EventLoopPool;
+using cun::UnitTest;
+
+enum class EventType {
+    on_add,
+    on_record,
+    on_rendezvous,
+    on_spawn,
+    on_unknown
+};
+
+struct Context;
+
+using Pool = EventLoopPool<EventType, Context *>;
+
+struct Context final {
+    Pool *pool { nullptr };
+    std::atomic_int sum { 0 };
+    std::atomic_int num_arrived { 0 };
+    std::atomic_int num_met { 0 };
+    std::mutex mutex;
+    std::vector<std::vector<int>> records;
+};
+
+Pool::event_entry make_entry()
+{
+    return {
+        make_pair(EventType::on_add, [](Context *ctx, std::any& args, std::any& results) {
+            ctx->sum += std::any_cast<int>(args);
+            if (results.has_value()) {
+                *std::any_cast<int *>(results) = ctx->sum;
+            }
+            return true;
+        }),
+        make_pair(EventType::on_record, [](Context *ctx, std::any& args, std::any&) {
+            const auto [key, seq] = std::any_cast<std::pair<int, int>>(args);
+            std::lock_guard<std::mutex> lck(ctx->mutex);
+            ctx->records[key].push_back(seq);
+            return true;
+        }),
+        make_pair(EventType::on_rendezvous, [](Context *ctx, std::any& args, std::any&) {
+            // Succeeds only if all the expected handlers run at the same time.
+            const auto expected = std::any_cast<int>(args);
+            ++ctx->num_arrived;
+            const auto deadline = std::chrono::steady_clock::now() + 1s;
+            while (ctx->num_arrived < expected) {
+                if (std::chrono::steady_clock::now() > deadline) {
+                    return false;
+                }
+                std::this_thread::yield();
+            }
+            ++ctx->num_met;
+            return true;
+        }),
+        make_pair(EventType::on_spawn, [](Context *ctx, std::any& args, std::any&) {
+            // Follow-up events go to the deque of this worker.
+            const auto n = std::any_cast<int>(args);
+            auto ok = true;
+            for (int i = 0; i < n; i++) {
+                ok = ctx->pool->post_event(EventType::on_rendezvous, n) && ok;
+            }
+            return ok;
+        }),
+    };
+}
+
+/* ---------------------------------------------------------------------- */
+/* Test code: basic usage. */
+/* ---------------------------------------------------------------------- */
+
+void test_basic(UnitTest& ut)
+{
+    CUN_UNITTEST_TITLE(ut, "Test code: Event loop pool - basic usage.");
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_EXEC(ut, Context context);
+    {
+        CUN_UNITTEST_EXEC(ut, Pool pool(2, make_entry(), &context));
+        CUN_UNITTEST_EXEC(ut, int result = 0);
+        CUN_UNITTEST_EVAL(ut, pool.num_workers() == 2);
+        CUN_UNITTEST_EVAL(ut, pool.send_event(EventType::on_add, 1, &result));
+        CUN_UNITTEST_EVAL(ut, result == 1);
+        CUN_UNITTEST_EVAL(ut, pool.send_event_by_key(42, EventType::on_add, 2, &result));
+        CUN_UNITTEST_EVAL(ut, result == 3);
+        CUN_UNITTEST_EVAL(ut, !pool.send_event(EventType::on_unknown));
+        CUN_UNITTEST_EVAL(ut, !pool.send_event_by_key(42, EventType::on_unknown));
+        for (int i = 0; i < 100; i++) {
+            (void) pool.post_event(EventType::on_add, 1);
+            (void) pool.post_event_by_key(i, EventType::on_add, 1);
+        }
+    }
+    CUN_UNITTEST_EVAL(ut, context.sum == 203);
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_EXEC(ut, Pool pool2(0));
+    CUN_UNITTEST_EVAL(ut, pool2.num_workers() >= 1);
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_RESET(ut);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Test code: ordering per key. */
+/* ---------------------------------------------------------------------- */
+
+void test_ordering_per_key(UnitTest& ut)
+{
+    CUN_UNITTEST_TITLE(ut, "Test code: Event loop pool - ordering per key.");
+    CUN_UNITTEST_NL(ut);
+
+    constexpr int NUM_KEYS = 8;
+    constexpr int NUM_EVENTS = 1000;
+
+    CUN_UNITTEST_EXEC(ut, Context context);
+    CUN_UNITTEST_EXEC(ut, context.records.resize(NUM_KEYS));
+    {
+        CUN_UNITTEST_EXEC(ut, Pool pool(4, make_entry(), &context));
+        for (int seq = 0; seq < NUM_EVENTS; seq++) {
+            for (int key = 0; key < NUM_KEYS; key++) {
+                (void) pool.post_event_by_key(key, EventType::on_record, std::make_pair(key, seq));
+            }
+        }
+    }
+    CUN_UNITTEST_EXEC(ut, bool in_order = true);
+    for (const auto& record : context.records) {
+        in_order = in_order && (record.size() == NUM_EVENTS);
+        for (int seq = 0; in_order && (seq < NUM_EVENTS); seq++) {
+            in_order = (record[seq] == seq);
+        }
+    }
+    CUN_UNITTEST_EVAL(ut, in_order);
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_RESET(ut);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Test code: run events in parallel. */
+/* ---------------------------------------------------------------------- */
+
+void test_parallel(UnitTest& ut)
+{
+    CUN_UNITTEST_TITLE(ut, "Test code: Event loop pool - run events in parallel.");
+    CUN_UNITTEST_NL(ut);
+
+    static constexpr int NUM_WORKERS = 4;
+
+    CUN_UNITTEST_EXEC(ut, Context context);
+    CUN_UNITTEST_EXEC(ut, Pool pool(NUM_WORKERS, make_entry(), &context));
+    CUN_UNITTEST_EXEC(ut, std::vector<std::thread> senders);
+    CUN_UNITTEST_EXEC(ut, std::atomic_int num_succeeded { 0 });
+    for (int i = 0; i < NUM_WORKERS; i++) {
+        senders.emplace_back([&pool, &num_succeeded]{
+            if (pool.send_event(EventType::on_rendezvous, NUM_WORKERS)) {
+                ++num_succeeded;
+            }
+        });
+    }
+    for (auto&& th : senders) {
+        th.join();
+    }
+    CUN_UNITTEST_EVAL(ut, num_succeeded == NUM_WORKERS);
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_RESET(ut);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Test code: steal events posted from a handler. */
+/* ---------------------------------------------------------------------- */
+
+void test_work_stealing(UnitTest& ut)
+{
+    CUN_UNITTEST_TITLE(ut, "Test code: Event loop pool - steal events posted from a handler.");
+    CUN_UNITTEST_NL(ut);
+
+    static constexpr int NUM_WORKERS = 4;
+
+    CUN_UNITTEST_EXEC(ut, Context context);
+    {
+        CUN_UNITTEST_EXEC(ut, Pool pool(NUM_WORKERS, make_entry(), &context));
+        CUN_UNITTEST_EXEC(ut, context.pool = &pool);
+        CUN_UNITTEST_EVAL(ut, pool.send_event(EventType::on_spawn, NUM_WORKERS));
+    }
+    // The rendezvous succeeds only if the other workers stole the follow-up events.
+    CUN_UNITTEST_EVAL(ut, context.num_met == NUM_WORKERS);
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_RESET(ut);
+}
+
+} // namespace
+
+/* ---------------------------------------------------------------------- */
+/* Main routine. */
+/* ---------------------------------------------------------------------- */
+
+int main()
+{
+    auto ut = CUN_UNITTEST_MAKE();
+
+    test_basic(ut);
+    test_ordering_per_key(ut);
+    test_parallel(ut);
+    test_work_stealing(ut);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,96 @@
+﻿// -*- coding: utf-8-with-signature-dos -*-
+// vim:fileencoding=utf-8:ff=dos
+//
+// Test code: Inline any.
+
+// C++ standard library
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <utility>
+
+// C++ user library
+#include "inline_any.hpp"
+#include "unittest.hpp"
+
+namespace {
+
+struct Counted final {
+    static int num_alive;
+    int value;
+
+    explicit Counted(const int v) noexcept : value { v } { num_alive++; }
+    Counted(Counted&& other) noexcept : value { other.value } { num_alive++; }
+    ~Counted() { num_alive--; }
+};
+
+int Counted::num_alive = 0;
+
+struct Large final {
+    char buf[64];
+};
+
+} // namespace
+
+int main()
+{
+    // C++ standard library
+    using std::int32_t;
+
+    // C++ user library
+    using cun::InlineAny;
+
+    auto ut = CUN_UNITTEST_MAKE();
+
+    CUN_UNITTEST_TITLE(ut, "Test code: Inline any.");
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "default parameter check");
+    CUN_UNITTEST_EXEC(ut, InlineAny<16> a);
+    CUN_UNITTEST_EVAL(ut, !a.has_value());
+    CUN_UNITTEST_EVAL(ut, a.get_if<int32_t>() == nullptr);
+    CUN_UNITTEST_EVAL(ut, InlineAny<16>::fits<int32_t>);
+    CUN_UNITTEST_EVAL(ut, !InlineAny<16>::fits<Large>);
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "store a value");
+    CUN_UNITTEST_EXEC(ut, a = InlineAny<16> { int32_t { 42 } });
+    CUN_UNITTEST_EVAL(ut, a.has_value());
+    CUN_UNITTEST_EVAL(ut, a.holds<int32_t>());
+    CUN_UNITTEST_EVAL(ut, !a.holds<std::uint32_t>());
+    CUN_UNITTEST_EVAL(ut, a.get_if<std::uint32_t>() == nullptr);
+    CUN_UNITTEST_EVAL(ut, *a.get_if<int32_t>() == 42);
+    CUN_UNITTEST_EXEC(ut, *a.get_if<int32_t>() = 43);
+    CUN_UNITTEST_EVAL(ut, *std::as_const(a).get_if<int32_t>() == 43);
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "emplace and destroy");
+    CUN_UNITTEST_EVAL(ut, a.emplace<Counted>(7).value == 7);
+    CUN_UNITTEST_EVAL(ut, Counted::num_alive == 1);
+    CUN_UNITTEST_EXEC(ut, a.emplace<int32_t>(8));
+    CUN_UNITTEST_EVAL(ut, Counted::num_alive == 0);
+    CUN_UNITTEST_EXEC(ut, a.emplace<Counted>(9));
+    CUN_UNITTEST_EXEC(ut, a.reset());
+    CUN_UNITTEST_EVAL(ut, !a.has_value());
+    CUN_UNITTEST_EVAL(ut, Counted::num_alive == 0);
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "move");
+    CUN_UNITTEST_EXEC(ut, a.emplace<Counted>(10));
+    CUN_UNITTEST_EXEC(ut, InlineAny<16> b { std::move(a) });
+    CUN_UNITTEST_EVAL(ut, !a.has_value());
+    CUN_UNITTEST_EVAL(ut, b.get_if<Counted>()->value == 10);
+    CUN_UNITTEST_EVAL(ut, Counted::num_alive == 1);
+    CUN_UNITTEST_EXEC(ut, a = std::move(b));
+    CUN_UNITTEST_EVAL(ut, !b.has_value());
+    CUN_UNITTEST_EVAL(ut, a.get_if<Counted>()->value == 10);
+    CUN_UNITTEST_EVAL(ut, Counted::num_alive == 1);
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "move-only value");
+    CUN_UNITTEST_EXEC(ut, InlineAny<16> c { std::make_unique<int32_t>(11) });
+    CUN_UNITTEST_EVAL(ut, **c.get_if<std::unique_ptr<int32_t>>() == 11);
+    CUN_UNITTEST_NL(ut);
+
+    return EXIT_SUCCESS;
+}
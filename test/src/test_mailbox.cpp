@@ -4,9 +4,16 @@
 // Test code: Mailbox.
 
 // C++ standard library
+#include <atomic>
 #include <chrono>
+#include <cstdint>
 #include <cstdlib>
+#include <iterator>
+#include <memory>
+#include <span>
 #include <string>
+#include <thread>
+#include <vector>
 
 // C++ user library
 #include "mailbox.hpp"
@@ -18,6 +25,7 @@ int main()
     // C++ standard library
     using namespace std::literals::chrono_literals;
     using std::string;
+    using std::vector;
 
     // C++ user library
     namespace system_tick = cun::system_tick;
@@ -125,5 +133,322 @@ int main()
     CUN_UNITTEST_EVAL(ut, val.empty());
     CUN_UNITTEST_NL(ut);
 
+    CUN_UNITTEST_NAME(ut, "pop some data at once");
+    CUN_UNITTEST_EXEC(ut, vector<string> vals);
+    CUN_UNITTEST_EXEC(ut, t1 = system_tick::millis());
+    CUN_UNITTEST_EVAL(ut, mbox.pop_n(std::back_inserter(vals), 2, 100ms) == 0);
+    CUN_UNITTEST_EXEC(ut, t2 = system_tick::millis());
+    CUN_UNITTEST_EVAL(ut, t2 - t1 >= 100);
+    CUN_UNITTEST_EVAL(ut, vals.empty());
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_EXEC(ut, mbox.push("A"));
+    CUN_UNITTEST_EXEC(ut, mbox.push("B"));
+    CUN_UNITTEST_EXEC(ut, mbox.push("C"));
+    CUN_UNITTEST_EVAL(ut, mbox.pop_n(std::back_inserter(vals), 0) == 0);
+    CUN_UNITTEST_EVAL(ut, mbox.pop_n(std::back_inserter(vals), 2) == 2);
+    CUN_UNITTEST_EVAL(ut, mbox.size() == 1);
+    CUN_UNITTEST_EVAL(ut, vals.size() == 2);
+    CUN_UNITTEST_EVAL(ut, vals[0] == "A" && vals[1] == "B");
+    CUN_UNITTEST_EVAL(ut, mbox.pop_n(std::back_inserter(vals), 2, 100ms) == 1);
+    CUN_UNITTEST_EVAL(ut, mbox.empty());
+    CUN_UNITTEST_EVAL(ut, vals.size() == 3);
+    CUN_UNITTEST_EVAL(ut, vals[2] == "C");
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_EXEC(ut, string buf[2]);
+    CUN_UNITTEST_EXEC(ut, mbox.push("D"));
+    CUN_UNITTEST_EVAL(ut, mbox.pop_n(buf, 2) == 1);
+    CUN_UNITTEST_EVAL(ut, buf[0] == "D" && buf[1].empty());
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "drain all data");
+    CUN_UNITTEST_EXEC(ut, vals.clear());
+    CUN_UNITTEST_EVAL(ut, mbox.drain(vals) == 0);
+    CUN_UNITTEST_EVAL(ut, vals.empty());
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_EXEC(ut, mbox.push("E"));
+    CUN_UNITTEST_EXEC(ut, mbox.push("F"));
+    CUN_UNITTEST_EXEC(ut, mbox.push("G"));
+    CUN_UNITTEST_EVAL(ut, mbox.drain(vals) == 3);
+    CUN_UNITTEST_EVAL(ut, mbox.empty());
+    CUN_UNITTEST_EVAL(ut, vals.size() == 3);
+    CUN_UNITTEST_EVAL(ut, vals[0] == "E" && vals[1] == "F" && vals[2] == "G");
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "push some data at once");
+    CUN_UNITTEST_EXEC(ut, vals = { "H", "I", "J" });
+    CUN_UNITTEST_EXEC(ut, mbox.push_range(vals.begin(), vals.end()));
+    CUN_UNITTEST_EVAL(ut, mbox.size() == 3);
+    CUN_UNITTEST_EVAL(ut, vals.size() == 3);
+    CUN_UNITTEST_EVAL(ut, vals[0] == "H" && vals[1] == "I" && vals[2] == "J");
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_EXEC(ut, const char *strs[] = { "K", "L" });
+    CUN_UNITTEST_EXEC(ut, mbox.push_range(std::begin(strs), std::end(strs)));
+    CUN_UNITTEST_EVAL(ut, mbox.size() == 5);
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_EXEC(ut, vals.clear());
+    CUN_UNITTEST_EVAL(ut, mbox.drain(vals) == 5);
+    CUN_UNITTEST_EVAL(ut, vals[0] == "H" && vals[1] == "I" && vals[2] == "J" && vals[3] == "K" && vals[4] == "L");
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_EXEC(ut, mbox.push_bulk(vals));
+    CUN_UNITTEST_EVAL(ut, mbox.size() == 5);
+    CUN_UNITTEST_EVAL(ut, vals.size() == 5);
+    CUN_UNITTEST_EVAL(ut, vals[0] == "H" && vals[4] == "L");
+    CUN_UNITTEST_EVAL(ut, mbox.drain(vals) == 5);
+    CUN_UNITTEST_EVAL(ut, vals.size() == 10);
+    CUN_UNITTEST_EVAL(ut, vals[5] == "H" && vals[9] == "L");
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "push some move-only data at once");
+    {
+        CUN_UNITTEST_EXEC(ut, Mailbox<std::unique_ptr<int>> mbox2);
+        CUN_UNITTEST_EXEC(ut, vector<std::unique_ptr<int>> ptrs);
+        CUN_UNITTEST_EXEC(ut, ptrs.push_back(std::make_unique<int>(1)));
+        CUN_UNITTEST_EXEC(ut, ptrs.push_back(std::make_unique<int>(2)));
+        CUN_UNITTEST_EXEC(ut, mbox2.push_bulk_move(ptrs));
+        CUN_UNITTEST_EVAL(ut, mbox2.size() == 2);
+        CUN_UNITTEST_EVAL(ut, !ptrs[0] && !ptrs[1]);
+        CUN_UNITTEST_EVAL(ut, *mbox2.pop() == 1);
+        CUN_UNITTEST_EVAL(ut, *mbox2.pop() == 2);
+        CUN_UNITTEST_EVAL(ut, mbox2.empty());
+        CUN_UNITTEST_NL(ut);
+
+        CUN_UNITTEST_EXEC(ut, ptrs.clear());
+        CUN_UNITTEST_EXEC(ut, ptrs.push_back(std::make_unique<int>(3)));
+        CUN_UNITTEST_EXEC(ut, mbox2.push_range(std::make_move_iterator(ptrs.begin()), std::make_move_iterator(ptrs.end())));
+        CUN_UNITTEST_EVAL(ut, !ptrs[0]);
+        CUN_UNITTEST_EVAL(ut, *mbox2.pop() == 3);
+        CUN_UNITTEST_EVAL(ut, mbox2.empty());
+    }
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "close mailbox");
+    CUN_UNITTEST_EVAL(ut, !mbox.closed());
+    CUN_UNITTEST_EVAL(ut, mbox.push("M"));
+    CUN_UNITTEST_EXEC(ut, mbox.close());
+    CUN_UNITTEST_EVAL(ut, mbox.closed());
+    CUN_UNITTEST_EVAL(ut, !mbox.push("N"));
+    CUN_UNITTEST_EVAL(ut, !mbox.emplace("N"));
+    CUN_UNITTEST_EVAL(ut, !mbox.push_range(vals.begin(), vals.end()));
+    CUN_UNITTEST_EVAL(ut, mbox.size() == 1);
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_EVAL(ut, mbox.pop(val));
+    CUN_UNITTEST_EVAL(ut, val == "M");
+    CUN_UNITTEST_EXEC(ut, t1 = system_tick::millis());
+    CUN_UNITTEST_EVAL(ut, !mbox.pop(val));
+    CUN_UNITTEST_EVAL(ut, !mbox.pop(val, 100ms));
+    CUN_UNITTEST_EVAL(ut, mbox.pop_n(std::back_inserter(vals), 2) == 0);
+    CUN_UNITTEST_EVAL(ut, mbox.pop_n(std::back_inserter(vals), 2, 100ms) == 0);
+    CUN_UNITTEST_EXEC(ut, t2 = system_tick::millis());
+    CUN_UNITTEST_EVAL(ut, t2 - t1 < 100);
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "close mailbox: wake up all waiting consumers");
+    {
+        CUN_UNITTEST_EXEC(ut, Mailbox<int> mbox3);
+        CUN_UNITTEST_EXEC(ut, std::atomic_int num_finished { 0 });
+        CUN_UNITTEST_EXEC(ut, vector<std::thread> consumers);
+        for (int i = 0; i < 4; i++) {
+            consumers.emplace_back([&mbox3, &num_finished]{
+                int v { 0 };
+                while (mbox3.pop(v)) {
+                    /*EMPTY*/
+                }
+                ++num_finished;
+            });
+        }
+        CUN_UNITTEST_EXEC(ut, std::this_thread::sleep_for(50ms));
+        CUN_UNITTEST_EVAL(ut, num_finished == 0);
+        CUN_UNITTEST_EXEC(ut, mbox3.close());
+        for (auto&& th : consumers) {
+            th.join();
+        }
+        CUN_UNITTEST_EVAL(ut, num_finished == 4);
+    }
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "statistics");
+    {
+        CUN_UNITTEST_EXEC(ut, Mailbox<string, true> mbox4);
+        CUN_UNITTEST_EXEC(ut, vector<string> vals4 { "X", "Y" });
+        CUN_UNITTEST_EXEC(ut, cun::MailboxStats stats = mbox4.stats());
+        CUN_UNITTEST_EVAL(ut, stats.num_pushed == 0);
+        CUN_UNITTEST_EVAL(ut, stats.num_popped == 0);
+        CUN_UNITTEST_EVAL(ut, stats.max_depth == 0);
+        CUN_UNITTEST_EXEC(ut, mbox4.push("A"));
+        CUN_UNITTEST_EXEC(ut, mbox4.emplace("B"));
+        CUN_UNITTEST_EXEC(ut, mbox4.push_range(vals4.begin(), vals4.end()));
+        CUN_UNITTEST_EXEC(ut, std::this_thread::sleep_for(10ms));
+        CUN_UNITTEST_EVAL(ut, mbox4.pop(val));
+        CUN_UNITTEST_EVAL(ut, val == "A");
+        CUN_UNITTEST_EXEC(ut, vector<string> rest);
+        CUN_UNITTEST_EXEC(ut, mbox4.drain(rest));
+        CUN_UNITTEST_EXEC(ut, stats = mbox4.stats());
+        CUN_UNITTEST_EVAL(ut, stats.num_pushed == 4);
+        CUN_UNITTEST_EVAL(ut, stats.num_popped == stats.num_pushed);
+        CUN_UNITTEST_EVAL(ut, stats.max_depth == stats.num_pushed);
+        CUN_UNITTEST_EVAL(ut, stats.latency_min >= 10ms);
+        CUN_UNITTEST_EVAL(ut, stats.latency_min <= stats.latency_mean);
+        CUN_UNITTEST_EVAL(ut, stats.latency_mean <= stats.latency_max);
+        CUN_UNITTEST_EXEC(ut, std::uint64_t num_histogram = 0);
+        for (const auto n : stats.latency_histogram) {
+            num_histogram += n;
+        }
+        CUN_UNITTEST_EVAL(ut, num_histogram == stats.num_popped);
+        CUN_UNITTEST_EVAL(ut, stats.latency_histogram[0] == 0);
+        CUN_UNITTEST_EVAL(ut, stats.lock_wait_max <= stats.lock_wait_total);
+        CUN_UNITTEST_EVAL(ut, stats.num_wakeups == 0);
+
+        std::thread producer([&mbox4]{
+            std::this_thread::sleep_for(50ms);
+            (void) mbox4.push("C");
+        });
+        CUN_UNITTEST_EVAL(ut, mbox4.pop(val));
+        CUN_UNITTEST_EXEC(ut, producer.join());
+        CUN_UNITTEST_EXEC(ut, stats = mbox4.stats());
+        CUN_UNITTEST_EVAL(ut, stats.num_wakeups >= 1);
+        CUN_UNITTEST_EVAL(ut, stats.num_spurious_wakeups < stats.num_wakeups);
+
+        CUN_UNITTEST_EXEC(ut, mbox4.reset_stats());
+        CUN_UNITTEST_EXEC(ut, stats = mbox4.stats());
+        CUN_UNITTEST_EVAL(ut, stats.num_pushed == 0);
+        CUN_UNITTEST_EVAL(ut, stats.num_popped == 0);
+        CUN_UNITTEST_EVAL(ut, stats.num_wakeups == 0);
+
+        CUN_UNITTEST_EVAL(ut, !mbox4.pop(val, 10ms));
+        CUN_UNITTEST_EVAL(ut, !mbox4.pop(val, 10ms));
+        CUN_UNITTEST_EVAL(ut, !mbox4.pop(val, 10ms));
+        CUN_UNITTEST_EXEC(ut, string vals[2]);
+        CUN_UNITTEST_EVAL(ut, mbox4.pop_n(vals, 2, 10ms) == 0);
+        CUN_UNITTEST_EXEC(ut, stats = mbox4.stats());
+        CUN_UNITTEST_EVAL(ut, stats.num_wakeups == 0);
+        CUN_UNITTEST_EVAL(ut, stats.num_spurious_wakeups == 0);
+    }
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "fixed capacity mailbox");
+    {
+        CUN_UNITTEST_EXEC(ut, cun::FixedMailbox<string, 3> mbox5);
+        CUN_UNITTEST_EVAL(ut, mbox5.max_size() == 3);
+        CUN_UNITTEST_EVAL(ut, mbox5.empty());
+        CUN_UNITTEST_EVAL(ut, !mbox5.full());
+        CUN_UNITTEST_EVAL(ut, mbox5.push("A"));
+        CUN_UNITTEST_EVAL(ut, mbox5.emplace("B"));
+        CUN_UNITTEST_EVAL(ut, mbox5.try_push("C"));
+        CUN_UNITTEST_EVAL(ut, mbox5.full());
+        CUN_UNITTEST_EVAL(ut, !mbox5.try_push("D"));
+        CUN_UNITTEST_EVAL(ut, mbox5.size() == 3);
+        CUN_UNITTEST_EVAL(ut, mbox5.pop(val));
+        CUN_UNITTEST_EVAL(ut, val == "A");
+        CUN_UNITTEST_EVAL(ut, mbox5.try_push("D"));
+        CUN_UNITTEST_EXEC(ut, vector<string> vals5);
+        CUN_UNITTEST_EVAL(ut, mbox5.pop_n(std::back_inserter(vals5), 2) == 2);
+        CUN_UNITTEST_EVAL(ut, (vals5 == vector<string> { "B", "C" }));
+        CUN_UNITTEST_EVAL(ut, mbox5.try_pop(val));
+        CUN_UNITTEST_EVAL(ut, val == "D");
+        CUN_UNITTEST_EVAL(ut, mbox5.empty());
+        CUN_UNITTEST_NL(ut);
+
+        CUN_UNITTEST_NAME(ut, "fixed capacity mailbox: push blocks while full");
+        CUN_UNITTEST_EXEC(ut, vals5 = { "E", "F", "G", "H", "I" });
+        std::thread producer([&mbox5, &vals5]{
+            (void) mbox5.push_range(vals5.begin(), vals5.end());
+            (void) mbox5.push("J");
+        });
+        CUN_UNITTEST_EXEC(ut, std::this_thread::sleep_for(50ms));
+        CUN_UNITTEST_EVAL(ut, mbox5.size() == 3);
+        CUN_UNITTEST_EXEC(ut, vector<string> out5);
+        for (int i = 0; i < 6; i++) {
+            out5.push_back(mbox5.pop());
+        }
+        CUN_UNITTEST_EXEC(ut, producer.join());
+        CUN_UNITTEST_EVAL(ut, (out5 == vector<string> { "E", "F", "G", "H", "I", "J" }));
+        CUN_UNITTEST_NL(ut);
+
+        CUN_UNITTEST_NAME(ut, "fixed capacity mailbox: close wakes up a blocked producer");
+        CUN_UNITTEST_EXEC(ut, mbox5.clear());
+        CUN_UNITTEST_EVAL(ut, mbox5.drain(out5) == 0);
+        CUN_UNITTEST_EXEC(ut, std::atomic_bool pushed { true });
+        std::thread producer2([&mbox5, &pushed]{
+            for (int i = 0; i < 4; i++) {
+                pushed = mbox5.push("K");
+            }
+        });
+        CUN_UNITTEST_EXEC(ut, std::this_thread::sleep_for(50ms));
+        CUN_UNITTEST_EVAL(ut, mbox5.full());
+        CUN_UNITTEST_EXEC(ut, mbox5.close());
+        CUN_UNITTEST_EXEC(ut, producer2.join());
+        CUN_UNITTEST_EVAL(ut, !pushed);
+        CUN_UNITTEST_EXEC(ut, out5.clear());
+        CUN_UNITTEST_EVAL(ut, mbox5.drain(out5) == 3);
+        CUN_UNITTEST_EVAL(ut, !mbox5.pop(val));
+    }
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "bounded push");
+    {
+        CUN_UNITTEST_EXEC(ut, Mailbox<string> mbox6);
+        CUN_UNITTEST_EVAL(ut, mbox6.try_push_bounded("A", 2));
+        CUN_UNITTEST_EVAL(ut, mbox6.push_bounded("B", 2));
+        CUN_UNITTEST_EVAL(ut, !mbox6.try_push_bounded("C", 2));
+        CUN_UNITTEST_EVAL(ut, mbox6.try_push_bounded("C", 3));
+        CUN_UNITTEST_NL(ut);
+
+        CUN_UNITTEST_COMMENT(ut, "drop the oldest mail which satisfies the predicate");
+        const auto not_a = [](const string& s) { return s != "A"; };
+        CUN_UNITTEST_EVAL(ut, mbox6.push_bounded_dropping("D", 3, not_a));
+        CUN_UNITTEST_EVAL(ut, mbox6.size() == 3);
+        CUN_UNITTEST_EVAL(ut, !mbox6.push_bounded_dropping("E", 3, [](const string&) { return false; }));
+        CUN_UNITTEST_NL(ut);
+
+        CUN_UNITTEST_COMMENT(ut, "replace the newest mail which satisfies the predicate");
+        CUN_UNITTEST_EVAL(ut, mbox6.push_bounded_replacing("E", 3, not_a));
+        CUN_UNITTEST_EVAL(ut, !mbox6.push_bounded_replacing("F", 3, [](const string& s) { return s == "X"; }));
+        CUN_UNITTEST_EXEC(ut, vector<string> vals6);
+        CUN_UNITTEST_EVAL(ut, mbox6.drain(vals6) == 3);
+        CUN_UNITTEST_EVAL(ut, (vals6 == vector<string> { "A", "C", "E" }));
+        CUN_UNITTEST_NL(ut);
+
+        CUN_UNITTEST_NAME(ut, "bounded push: blocks while the limit is reached");
+        CUN_UNITTEST_EVAL(ut, mbox6.push_bounded("A", 1));
+        std::thread producer3([&mbox6]{
+            (void) mbox6.push_bounded("B", 1);
+        });
+        CUN_UNITTEST_EXEC(ut, std::this_thread::sleep_for(50ms));
+        CUN_UNITTEST_EVAL(ut, mbox6.size() == 1);
+        CUN_UNITTEST_EVAL(ut, mbox6.pop() == "A");
+        CUN_UNITTEST_EXEC(ut, producer3.join());
+        CUN_UNITTEST_EVAL(ut, mbox6.pop() == "B");
+        CUN_UNITTEST_NL(ut);
+
+        CUN_UNITTEST_NAME(ut, "bounded push: producers with different limits");
+        for (int i = 0; i < 10; i++) {
+            (void) mbox6.push("X");
+        }
+        std::thread producer4([&mbox6]{
+            (void) mbox6.push_bounded("A", 5);
+        });
+        std::thread producer5([&mbox6]{
+            (void) mbox6.push_bounded("B", 10);
+        });
+        CUN_UNITTEST_EXEC(ut, std::this_thread::sleep_for(50ms));
+        CUN_UNITTEST_EVAL(ut, mbox6.try_pop(val));
+        CUN_UNITTEST_EXEC(ut, for (int i = 0; (i < 100) && (mbox6.size() < 10); i++) std::this_thread::sleep_for(2ms));
+        CUN_UNITTEST_EVAL(ut, mbox6.size() == 10);
+        CUN_UNITTEST_EXEC(ut, mbox6.clear());
+        CUN_UNITTEST_EXEC(ut, producer4.join());
+        CUN_UNITTEST_EXEC(ut, producer5.join());
+        CUN_UNITTEST_EXEC(ut, mbox6.clear());
+        CUN_UNITTEST_EXEC(ut, mbox6.close());
+        CUN_UNITTEST_EVAL(ut, !mbox6.push_bounded("C", 1));
+    }
+    CUN_UNITTEST_NL(ut);
+
     return EXIT_SUCCESS;
 }
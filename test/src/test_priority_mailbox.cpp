@@ -0,0 +1,146 @@
+﻿// -*- coding: utf-8-with-signature-dos -*-
+// vim:fileencoding=utf-8:ff=dos
+//
+// Test code: Priority mailbox.
+
+// C++ standard library
+#include <chrono>
+#include <cstdlib>
+#include <string>
+
+// C++ user library
+#include "priority_mailbox.hpp"
+#include "system_tick.hpp"
+#include "unittest.hpp"
+
+namespace {
+
+enum class Priority {
+    bulk,
+    normal,
+    urgent
+};
+
+struct Mail final {
+    Priority priority { Priority::normal };
+    std::string text;
+};
+
+struct ByPriority final {
+    bool operator()(const Mail& lhs, const Mail& rhs) const noexcept {
+        return lhs.priority < rhs.priority;
+    }
+};
+
+} // namespace
+
+int main()
+{
+    // C++ standard library
+    using namespace std::literals::chrono_literals;
+
+    // C++ user library
+    namespace system_tick = cun::system_tick;
+    using cun::PriorityMailbox;
+
+    auto ut = CUN_UNITTEST_MAKE();
+
+    CUN_UNITTEST_TITLE(ut, "Test code: Priority mailbox.");
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_EXEC(ut, PriorityMailbox<Mail, ByPriority> mbox);
+    CUN_UNITTEST_EXEC(ut, Mail val);
+    CUN_UNITTEST_EXEC(ut, std::chrono::milliseconds::rep t1, t2);
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "default parameter check");
+    CUN_UNITTEST_EVAL(ut, mbox.empty());
+    CUN_UNITTEST_EVAL(ut, mbox.size() == 0);
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_EXEC(ut, t1 = system_tick::millis());
+    CUN_UNITTEST_EVAL(ut, !mbox.pop(val, 100ms));
+    CUN_UNITTEST_EXEC(ut, t2 = system_tick::millis());
+    CUN_UNITTEST_EVAL(ut, t2 - t1 >= 100);
+    CUN_UNITTEST_EVAL(ut, val.text.empty());
+    CUN_UNITTEST_EVAL(ut, !mbox.try_pop(val));
+    CUN_UNITTEST_EVAL(ut, val.text.empty());
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "push data");
+    CUN_UNITTEST_EXEC(ut, Mail m1 { Priority::bulk, "bulk 1" });
+    CUN_UNITTEST_EXEC(ut, mbox.push(m1));
+    CUN_UNITTEST_EXEC(ut, mbox.push(Mail { Priority::normal, "normal 1" }));
+    CUN_UNITTEST_EXEC(ut, mbox.emplace(Priority::bulk, "bulk 2"));
+    CUN_UNITTEST_EXEC(ut, mbox.emplace(Priority::urgent, "urgent 1"));
+    CUN_UNITTEST_EXEC(ut, mbox.emplace(Priority::normal, "normal 2"));
+    CUN_UNITTEST_EXEC(ut, mbox.emplace(Priority::urgent, "urgent 2"));
+    CUN_UNITTEST_EVAL(ut, !mbox.empty());
+    CUN_UNITTEST_EVAL(ut, mbox.size() == 6);
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "pop data: higher priority first, FIFO within the same priority");
+    CUN_UNITTEST_EXEC(ut, val = mbox.pop());
+    CUN_UNITTEST_EVAL(ut, val.text == "urgent 1");
+    CUN_UNITTEST_EXEC(ut, mbox.pop(val));
+    CUN_UNITTEST_EVAL(ut, val.text == "urgent 2");
+    CUN_UNITTEST_EXEC(ut, t1 = system_tick::millis());
+    CUN_UNITTEST_EVAL(ut, mbox.pop(val, 100ms));
+    CUN_UNITTEST_EXEC(ut, t2 = system_tick::millis());
+    CUN_UNITTEST_EVAL(ut, t2 - t1 < 100);
+    CUN_UNITTEST_EVAL(ut, val.text == "normal 1");
+    CUN_UNITTEST_EVAL(ut, mbox.try_pop(val));
+    CUN_UNITTEST_EVAL(ut, val.text == "normal 2");
+    CUN_UNITTEST_EVAL(ut, mbox.size() == 2);
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "urgent mail jumps the queue");
+    CUN_UNITTEST_EXEC(ut, mbox.emplace(Priority::urgent, "urgent 3"));
+    CUN_UNITTEST_EXEC(ut, val = mbox.pop());
+    CUN_UNITTEST_EVAL(ut, val.text == "urgent 3");
+    CUN_UNITTEST_EXEC(ut, val = mbox.pop());
+    CUN_UNITTEST_EVAL(ut, val.text == "bulk 1");
+    CUN_UNITTEST_EXEC(ut, val = mbox.pop());
+    CUN_UNITTEST_EVAL(ut, val.text == "bulk 2");
+    CUN_UNITTEST_EVAL(ut, mbox.empty());
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "clear data");
+    CUN_UNITTEST_EXEC(ut, mbox.emplace(Priority::bulk, "A"));
+    CUN_UNITTEST_EXEC(ut, mbox.emplace(Priority::urgent, "B"));
+    CUN_UNITTEST_EVAL(ut, mbox.size() == 2);
+    CUN_UNITTEST_EXEC(ut, mbox.clear());
+    CUN_UNITTEST_EVAL(ut, mbox.empty());
+    CUN_UNITTEST_EVAL(ut, !mbox.try_pop(val));
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "default comparator");
+    {
+        CUN_UNITTEST_EXEC(ut, PriorityMailbox<int> mbox2);
+        CUN_UNITTEST_EXEC(ut, mbox2.push(2));
+        CUN_UNITTEST_EXEC(ut, mbox2.push(3));
+        CUN_UNITTEST_EXEC(ut, mbox2.push(1));
+        CUN_UNITTEST_EVAL(ut, mbox2.pop() == 3);
+        CUN_UNITTEST_EVAL(ut, mbox2.pop() == 2);
+        CUN_UNITTEST_EVAL(ut, mbox2.pop() == 1);
+    }
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "close mailbox");
+    CUN_UNITTEST_EVAL(ut, !mbox.closed());
+    CUN_UNITTEST_EVAL(ut, mbox.emplace(Priority::bulk, "C"));
+    CUN_UNITTEST_EXEC(ut, mbox.close());
+    CUN_UNITTEST_EVAL(ut, mbox.closed());
+    CUN_UNITTEST_EVAL(ut, !mbox.emplace(Priority::urgent, "D"));
+    CUN_UNITTEST_EVAL(ut, mbox.size() == 1);
+    CUN_UNITTEST_EVAL(ut, mbox.pop(val));
+    CUN_UNITTEST_EVAL(ut, val.text == "C");
+    CUN_UNITTEST_EXEC(ut, t1 = system_tick::millis());
+    CUN_UNITTEST_EVAL(ut, !mbox.pop(val));
+    CUN_UNITTEST_EVAL(ut, !mbox.pop(val, 100ms));
+    CUN_UNITTEST_EXEC(ut, t2 = system_tick::millis());
+    CUN_UNITTEST_EVAL(ut, t2 - t1 < 100);
+    CUN_UNITTEST_NL(ut);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,147 @@
+﻿// -*- coding: utf-8-with-signature-dos -*-
+// vim:fileencoding=utf-8:ff=dos
+//
+// Test code: Sharded mailbox.
+
+// C++ standard library
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+// C++ user library
+#include "sharded_mailbox.hpp"
+#include "system_tick.hpp"
+#include "unittest.hpp"
+
+int main()
+{
+    // C++ standard library
+    using namespace std::literals::chrono_literals;
+    using std::uint32_t;
+
+    // C++ user library
+    namespace system_tick = cun::system_tick;
+    using cun::ShardedMailbox;
+
+    auto ut = CUN_UNITTEST_MAKE();
+
+    CUN_UNITTEST_TITLE(ut, "Test code: Sharded mailbox.");
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_EXEC(ut, ShardedMailbox<int, 2, 2> mbox);
+    CUN_UNITTEST_EXEC(ut, int val = 0);
+    CUN_UNITTEST_EXEC(ut, std::chrono::milliseconds::rep t1, t2);
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "default parameter check");
+    CUN_UNITTEST_EVAL(ut, mbox.empty());
+    CUN_UNITTEST_EVAL(ut, mbox.max_producers() == 2);
+    CUN_UNITTEST_EVAL(ut, mbox.size() == 0);
+    CUN_UNITTEST_EXEC(ut, t1 = system_tick::millis());
+    CUN_UNITTEST_EVAL(ut, !mbox.pop(val, 100ms));
+    CUN_UNITTEST_EXEC(ut, t2 = system_tick::millis());
+    CUN_UNITTEST_EVAL(ut, t2 - t1 >= 100);
+    CUN_UNITTEST_EVAL(ut, !mbox.try_pop(val));
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "register producers");
+    CUN_UNITTEST_EXEC(ut, auto p1 = mbox.register_producer());
+    CUN_UNITTEST_EXEC(ut, auto p2 = mbox.register_producer());
+    CUN_UNITTEST_EXEC(ut, auto p3 = mbox.register_producer());
+    CUN_UNITTEST_EVAL(ut, static_cast<bool>(p1));
+    CUN_UNITTEST_EVAL(ut, static_cast<bool>(p2));
+    CUN_UNITTEST_EVAL(ut, !p3);
+    CUN_UNITTEST_EVAL(ut, !p3.push(0));
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "push data");
+    CUN_UNITTEST_EVAL(ut, p1.push(1));
+    CUN_UNITTEST_EVAL(ut, p1.try_push(2));
+    CUN_UNITTEST_EVAL(ut, !p1.try_push(3));
+    CUN_UNITTEST_EVAL(ut, p2.push(11));
+    CUN_UNITTEST_EVAL(ut, p2.push(12));
+    CUN_UNITTEST_EVAL(ut, !mbox.empty());
+    CUN_UNITTEST_EVAL(ut, mbox.size() == 4);
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "pop data: visit lanes in round-robin order");
+    CUN_UNITTEST_EXEC(ut, val = mbox.pop());
+    CUN_UNITTEST_EVAL(ut, val == 1);
+    CUN_UNITTEST_EVAL(ut, mbox.pop(val));
+    CUN_UNITTEST_EVAL(ut, val == 11);
+    CUN_UNITTEST_EVAL(ut, mbox.pop(val, 100ms));
+    CUN_UNITTEST_EVAL(ut, val == 2);
+    CUN_UNITTEST_EVAL(ut, mbox.try_pop(val));
+    CUN_UNITTEST_EVAL(ut, val == 12);
+    CUN_UNITTEST_EVAL(ut, mbox.empty());
+    CUN_UNITTEST_EVAL(ut, !mbox.try_pop(val));
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "release a producer");
+    CUN_UNITTEST_EVAL(ut, p2.push(13));
+    CUN_UNITTEST_EXEC(ut, p2.release());
+    CUN_UNITTEST_EVAL(ut, !p2);
+    CUN_UNITTEST_EVAL(ut, !p2.push(14));
+    CUN_UNITTEST_EXEC(ut, p3 = mbox.register_producer());
+    CUN_UNITTEST_EVAL(ut, !p3);
+    CUN_UNITTEST_EVAL(ut, mbox.pop(val));
+    CUN_UNITTEST_EVAL(ut, val == 13);
+    CUN_UNITTEST_EVAL(ut, !mbox.try_pop(val));
+    CUN_UNITTEST_EXEC(ut, p3 = mbox.register_producer());
+    CUN_UNITTEST_EVAL(ut, static_cast<bool>(p3));
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "close mailbox");
+    CUN_UNITTEST_EVAL(ut, p3.push(21));
+    CUN_UNITTEST_EXEC(ut, mbox.close());
+    CUN_UNITTEST_EVAL(ut, mbox.closed());
+    CUN_UNITTEST_EVAL(ut, !p1.push(22));
+    CUN_UNITTEST_EVAL(ut, !p3.try_push(23));
+    CUN_UNITTEST_EVAL(ut, mbox.pop(val));
+    CUN_UNITTEST_EVAL(ut, val == 21);
+    CUN_UNITTEST_EXEC(ut, t1 = system_tick::millis());
+    CUN_UNITTEST_EVAL(ut, !mbox.pop(val));
+    CUN_UNITTEST_EVAL(ut, !mbox.pop(val, 100ms));
+    CUN_UNITTEST_EXEC(ut, t2 = system_tick::millis());
+    CUN_UNITTEST_EVAL(ut, t2 - t1 < 100);
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "multiple producers, single consumer");
+    {
+        constexpr uint32_t NUM_PRODUCERS = 8;
+        constexpr uint32_t NUM_MAILS = 10000;
+
+        CUN_UNITTEST_EXEC(ut, ShardedMailbox<uint32_t, 64, NUM_PRODUCERS> mbox2);
+        CUN_UNITTEST_EXEC(ut, std::vector<std::thread> producers);
+        for (uint32_t i = 0; i < NUM_PRODUCERS; i++) {
+            producers.emplace_back([&mbox2, i]{
+                auto producer = mbox2.register_producer();
+                for (uint32_t n = 0; n < NUM_MAILS; n++) {
+                    (void) producer.push(i * NUM_MAILS + n);
+                }
+            });
+        }
+        CUN_UNITTEST_EXEC(ut, std::vector<uint32_t> last(NUM_PRODUCERS, 0));
+        CUN_UNITTEST_EXEC(ut, bool in_order = true);
+        CUN_UNITTEST_EXEC(ut, std::uint64_t sum = 0);
+        for (uint32_t n = 0; n < NUM_PRODUCERS * NUM_MAILS; n++) {
+            const auto v = mbox2.pop();
+            const auto id = v / NUM_MAILS;
+            const auto seq = v % NUM_MAILS + 1;
+            in_order = in_order && (seq > last[id]);
+            last[id] = seq;
+            sum += v;
+        }
+        for (auto&& th : producers) {
+            th.join();
+        }
+        CUN_UNITTEST_EVAL(ut, in_order);
+        CUN_UNITTEST_EVAL(ut, sum == std::uint64_t { NUM_PRODUCERS * NUM_MAILS } * (NUM_PRODUCERS * NUM_MAILS - 1) / 2);
+        CUN_UNITTEST_EVAL(ut, mbox2.empty());
+    }
+    CUN_UNITTEST_NL(ut);
+
+    return EXIT_SUCCESS;
+}
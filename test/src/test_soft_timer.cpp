@@ -4,10 +4,14 @@
 // Test code: A simple software timer.
 
 // C++ standard library
+#include <array>
 #include <atomic>
 #include <chrono>
+#include <cstdint>
 #include <cstdlib>
+#include <functional>
 #include <stdexcept>
+#include <thread>
 
 // C++ user library
 #include "soft_timer.hpp"
@@ -295,6 +299,118 @@ int main()
     }
     CUN_UNITTEST_NL(ut);
 
+    CUN_UNITTEST_NAME(ut, "restart without a new thread");
+    {
+        CUN_UNITTEST_EXEC(ut, std::atomic_uint count { 0 });
+        CUN_UNITTEST_EXEC(ut, std::atomic<std::thread::id> worker);
+        CUN_UNITTEST_EXEC(ut, auto timer = create(10ms, [&count, &worker]{ worker = std::this_thread::get_id(); ++count; }));
+        CUN_UNITTEST_EVAL(ut, timer.start());
+        CUN_UNITTEST_EXEC(ut, while (count < 1) sleep_for(10ms));
+        CUN_UNITTEST_EXEC(ut, const auto first = worker.load());
+        CUN_UNITTEST_EVAL(ut, timer.stop());
+        CUN_UNITTEST_EVAL(ut, timer.start());
+        CUN_UNITTEST_EVAL(ut, timer.restart());
+        CUN_UNITTEST_EXEC(ut, while (count < 3) sleep_for(10ms));
+        CUN_UNITTEST_EVAL(ut, worker.load() == first);
+        CUN_UNITTEST_EVAL(ut, timer.stop());
+    }
+    CUN_UNITTEST_NL(ut);
+    {
+        CUN_UNITTEST_EXEC(ut, std::atomic_uint count { 0 });
+        CUN_UNITTEST_EXEC(ut, auto watchdog = create(50ms, [&count]{ ++count; }));
+        CUN_UNITTEST_EVAL(ut, watchdog.start());
+        CUN_UNITTEST_EXEC(ut, const auto t1 = system_tick::millis());
+        CUN_UNITTEST_EXEC(ut, bool ok = true);
+        for (int i = 0; i < 10000; i++) {
+            ok = watchdog.restart() && ok;
+        }
+        CUN_UNITTEST_EXEC(ut, const auto elapsed = system_tick::millis() - t1);
+        CUN_UNITTEST_EVAL(ut, ok);
+        CUN_UNITTEST_EVAL(ut, (count == 0) || (elapsed >= 50));
+        CUN_UNITTEST_EVAL(ut, watchdog.stop());
+    }
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "stop waits for the running action");
+    {
+        CUN_UNITTEST_EXEC(ut, std::atomic_bool entered { false });
+        CUN_UNITTEST_EXEC(ut, std::atomic_bool finished { false });
+        CUN_UNITTEST_EXEC(ut, auto timer = create(10ms, [&entered, &finished]{
+            entered = true;
+            sleep_for(50ms);
+            finished = true;
+        }));
+        CUN_UNITTEST_EVAL(ut, timer.start());
+        CUN_UNITTEST_EXEC(ut, while (!entered) sleep_for(1ms));
+        CUN_UNITTEST_EVAL(ut, timer.stop());
+        CUN_UNITTEST_EVAL(ut, finished);
+    }
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "stop from the action");
+    {
+        CUN_UNITTEST_EXEC(ut, std::atomic_uint count { 0 });
+        CUN_UNITTEST_EXEC(ut, std::function<void()> stop_timer);
+        CUN_UNITTEST_EXEC(ut, auto timer = create(10ms, [&count, &stop_timer]{ if (++count == 2) stop_timer(); }));
+        CUN_UNITTEST_EXEC(ut, stop_timer = [&timer]{ (void) timer.stop(); });
+        CUN_UNITTEST_EVAL(ut, timer.start());
+        CUN_UNITTEST_EXEC(ut, sleep_for(100ms));
+        CUN_UNITTEST_EVAL(ut, count == 2);
+        CUN_UNITTEST_EVAL(ut, timer.start());
+        CUN_UNITTEST_EXEC(ut, while (count < 3) sleep_for(10ms));
+        CUN_UNITTEST_EVAL(ut, timer.stop());
+    }
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "overrun policy");
+    {
+        // The ticks are at 50ms, 100ms, 150ms, ... after start, and the first
+        // action (at 50ms) overruns the ticks at 100ms and 150ms. The times are
+        // measured from start, so the checks do not depend on how late each
+        // action runs.
+        const auto measure = [](const OverrunPolicy policy, std::uint64_t& missed) {
+            std::array<std::atomic<milliseconds::rep>, 4> times {};
+            std::atomic_uint count { 0 };
+            auto timer = create(50ms, [&times, &count]{
+                const auto n = count.load();
+                if (n < times.size()) {
+                    times[n] = system_tick::millis();
+                }
+                if (n == 0) {
+                    sleep_for(120ms);
+                }
+                ++count;
+            });
+            timer.set_overrun_policy(policy);
+            const auto start = system_tick::millis();
+            (void) timer.start();
+            while (count < times.size()) {
+                sleep_for(5ms);
+            }
+            (void) timer.stop();
+            missed = timer.missed_ticks();
+            return std::array<milliseconds::rep, 4> {
+                times[0] - start, times[1] - start, times[2] - start, times[3] - start
+            };
+        };
+        const auto on_phase = [](const milliseconds::rep t) { return t % 50 < 20; };
+        CUN_UNITTEST_EXEC(ut, std::uint64_t missed = 0);
+        CUN_UNITTEST_EXEC(ut, auto t = measure(OverrunPolicy::catch_up, missed));
+        CUN_UNITTEST_EVAL(ut, t[1] - t[0] >= 120);
+        CUN_UNITTEST_EVAL(ut, t[2] - t[1] < 25);
+        CUN_UNITTEST_EVAL(ut, missed >= 2);
+        CUN_UNITTEST_EXEC(ut, t = measure(OverrunPolicy::skip, missed));
+        CUN_UNITTEST_EVAL(ut, t[1] >= 200 && on_phase(t[1]));
+        CUN_UNITTEST_EVAL(ut, t[2] >= 250 && on_phase(t[2]));
+        CUN_UNITTEST_EVAL(ut, t[3] >= 300 && on_phase(t[3]));
+        CUN_UNITTEST_EVAL(ut, missed >= 2);
+        CUN_UNITTEST_EXEC(ut, t = measure(OverrunPolicy::from_completion, missed));
+        CUN_UNITTEST_EVAL(ut, t[1] - t[0] >= 170);
+        CUN_UNITTEST_EVAL(ut, t[2] - t[1] >= 49);
+        CUN_UNITTEST_EVAL(ut, missed >= 2);
+    }
+    CUN_UNITTEST_NL(ut);
+
     CUN_UNITTEST_NAME(ut, "destructor test (delete an object without stopping)");
     {
         CUN_UNITTEST_EXEC(ut, auto timer = create(10ms, []{}));
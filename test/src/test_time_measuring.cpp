@@ -312,6 +312,45 @@ void test_TimeInterval(UnitTest& ut)
     CUN_UNITTEST_RESET(ut);
 }
 
+void test_DurationLog(UnitTest& ut)
+{
+    CUN_UNITTEST_TITLE(ut, "Test code: A time measuring class - DurationLog.");
+    CUN_UNITTEST_NL(ut);
+
+    using Log = DurationLog<4, milliseconds>;
+
+    CUN_UNITTEST_EXEC(ut, Log log { "DurationLog" });
+    CUN_UNITTEST_EXEC(ut, Log::report_type report);
+    CUN_UNITTEST_EVAL(ut, log.empty());
+    CUN_UNITTEST_EVAL(ut, !log.make_report(report));
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_EXEC(ut, log.record(duration_cast<Log::duration>(100ms)));
+    CUN_UNITTEST_EXEC(ut, log.record(duration_cast<Log::duration>(300ms)));
+    CUN_UNITTEST_EVAL(ut, log.size() == 2);
+    CUN_UNITTEST_EVAL(ut, log.last_value() == 300ms);
+    CUN_UNITTEST_EVAL(ut, log.make_report(report));
+    CUN_UNITTEST_EVAL(ut, report.num_data == 2);
+    CUN_UNITTEST_EVAL(ut, report.min == 100ms);
+    CUN_UNITTEST_EVAL(ut, report.max == 300ms);
+    CUN_UNITTEST_EVAL(ut, report.mean == 200ms);
+    CUN_UNITTEST_EVAL(ut, report.stdev == 100ms);
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_COMMENT(ut, "Overwrite the oldest value");
+    for (auto i = 0; i < 4; i++) {
+        log.record(duration_cast<Log::duration>(50ms));
+    }
+    CUN_UNITTEST_EVAL(ut, log.size() == 4);
+    CUN_UNITTEST_EVAL(ut, log.make_report(report));
+    CUN_UNITTEST_EVAL(ut, report.max == 50ms);
+    CUN_UNITTEST_EXEC(ut, log.clear());
+    CUN_UNITTEST_EVAL(ut, log.empty());
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_RESET(ut);
+}
+
 } // namespace
 
 int main()
@@ -320,6 +359,7 @@ int main()
 
     test_ElapsedTime(ut);
     test_TimeInterval(ut);
+    test_DurationLog(ut);
 
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,279 @@
+﻿// -*- coding: utf-8-with-signature-dos -*-
+// vim:fileencoding=utf-8:ff=dos
+//
+// Test code: A timer service.
+
+// C++ standard library
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// C++ user library
+#include "system_tick.hpp"
+#include "timer_service.hpp"
+#include "unittest.hpp"
+
+int main()
+{
+    // C++ standard library
+    using namespace std::literals::chrono_literals;
+    using std::chrono::milliseconds;
+    using std::this_thread::sleep_for;
+
+    // C++ user library
+    using namespace cun::soft_timer;
+    namespace system_tick = cun::system_tick;
+
+    auto ut = CUN_UNITTEST_MAKE();
+
+    CUN_UNITTEST_TITLE(ut, "Test code: A timer service.");
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_EXEC(ut, TimerService service);
+    CUN_UNITTEST_EVAL(ut, service.num_threads() == 1);
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "constructor parameter check");
+    try {
+        CUN_UNITTEST_EXEC(ut, auto timer = service.create(0ms, []{}));
+        CUN_UNITTEST_EVAL(ut, false);
+    } catch (const std::invalid_argument& e) {
+        CUN_UNITTEST_EVAL(ut, true);
+        CUN_UNITTEST_ECHO(ut, e.what());
+    }
+    CUN_UNITTEST_NL(ut);
+
+    try {
+        CUN_UNITTEST_EXEC(ut, auto timer = service.create(1ms, 0, []{}));
+        CUN_UNITTEST_EVAL(ut, false);
+    } catch (const std::invalid_argument& e) {
+        CUN_UNITTEST_EVAL(ut, true);
+        CUN_UNITTEST_ECHO(ut, e.what());
+    }
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "typical usage (repeat forever)");
+    {
+        CUN_UNITTEST_EXEC(ut, std::atomic_uint count { 0 });
+        CUN_UNITTEST_EXEC(ut, auto timer = service.create(10ms, FOREVER, [&count]{ ++count; }));
+        CUN_UNITTEST_EVAL(ut, !timer.expired());
+        CUN_UNITTEST_EVAL(ut, timer.start());
+        CUN_UNITTEST_EXEC(ut, while (count < 5) sleep_for(10ms));
+        CUN_UNITTEST_EVAL(ut, !timer.expired());
+        CUN_UNITTEST_EVAL(ut, timer.stop());
+        CUN_UNITTEST_EXEC(ut, const auto n = count.load());
+        CUN_UNITTEST_EXEC(ut, sleep_for(50ms));
+        CUN_UNITTEST_EVAL(ut, count == n);
+        CUN_UNITTEST_EVAL(ut, !timer.expired());
+    }
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "typical usage (with max repeat count)");
+    {
+        CUN_UNITTEST_EXEC(ut, std::atomic_uint count { 0 });
+        CUN_UNITTEST_EXEC(ut, auto timer = service.create(10ms, 3, [&count]{ ++count; }));
+        CUN_UNITTEST_EVAL(ut, timer.start());
+        CUN_UNITTEST_EXEC(ut, while (!timer.expired()) sleep_for(10ms));
+        CUN_UNITTEST_EXEC(ut, sleep_for(100ms));
+        CUN_UNITTEST_EVAL(ut, count == 3);
+        CUN_UNITTEST_EVAL(ut, timer.stop());
+        CUN_UNITTEST_EVAL(ut, !timer.expired());
+    }
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "run immediately");
+    {
+        CUN_UNITTEST_EXEC(ut, std::atomic<milliseconds::rep> t2 { 0 });
+        CUN_UNITTEST_EXEC(ut, auto timer = service.create(100ms, 1, false, [&t2]{ t2 = system_tick::millis(); }));
+        CUN_UNITTEST_EXEC(ut, const auto t1 = system_tick::millis());
+        CUN_UNITTEST_EVAL(ut, timer.start());
+        CUN_UNITTEST_EXEC(ut, while (!timer.expired()) sleep_for(10ms));
+        CUN_UNITTEST_EXEC(ut, const auto elapsed = t2 - t1);
+        CUN_UNITTEST_EVAL(ut, elapsed >= 100 && elapsed < 150);
+    }
+    CUN_UNITTEST_NL(ut);
+    {
+        CUN_UNITTEST_EXEC(ut, std::atomic<milliseconds::rep> t2 { 0 });
+        CUN_UNITTEST_EXEC(ut, auto timer = service.create(100ms, 1, true, [&t2]{ t2 = system_tick::millis(); }));
+        CUN_UNITTEST_EXEC(ut, const auto t1 = system_tick::millis());
+        CUN_UNITTEST_EVAL(ut, timer.start());
+        CUN_UNITTEST_EXEC(ut, while (!timer.expired()) sleep_for(10ms));
+        CUN_UNITTEST_EXEC(ut, const auto elapsed = t2 - t1);
+        CUN_UNITTEST_EVAL(ut, elapsed >= 0 && elapsed < 50);
+    }
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "restart timer, start twice, stop twice");
+    {
+        CUN_UNITTEST_EXEC(ut, std::atomic_uint count { 0 });
+        CUN_UNITTEST_EXEC(ut, auto timer = service.create(10ms, 3, [&count]{ ++count; }));
+        CUN_UNITTEST_EVAL(ut, timer.start());
+        CUN_UNITTEST_EVAL(ut, !timer.start());
+        CUN_UNITTEST_EXEC(ut, while (!timer.expired()) sleep_for(10ms));
+        CUN_UNITTEST_EVAL(ut, count == 3);
+        CUN_UNITTEST_EXEC(ut, count = 0);
+        CUN_UNITTEST_EVAL(ut, timer.restart());
+        CUN_UNITTEST_EVAL(ut, !timer.expired());
+        CUN_UNITTEST_EXEC(ut, while (!timer.expired()) sleep_for(10ms));
+        CUN_UNITTEST_EVAL(ut, count == 3);
+        CUN_UNITTEST_EVAL(ut, timer.stop());
+        CUN_UNITTEST_EVAL(ut, timer.stop());
+    }
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "stop waits for the running action");
+    {
+        CUN_UNITTEST_EXEC(ut, std::atomic_bool entered { false });
+        CUN_UNITTEST_EXEC(ut, std::atomic_bool finished { false });
+        CUN_UNITTEST_EXEC(ut, auto timer = service.create(10ms, [&entered, &finished]{
+            entered = true;
+            sleep_for(50ms);
+            finished = true;
+        }));
+        CUN_UNITTEST_EVAL(ut, timer.start());
+        CUN_UNITTEST_EXEC(ut, while (!entered) sleep_for(1ms));
+        CUN_UNITTEST_EVAL(ut, timer.stop());
+        CUN_UNITTEST_EVAL(ut, finished);
+    }
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "stop from the action");
+    {
+        CUN_UNITTEST_EXEC(ut, std::atomic_uint count { 0 });
+        CUN_UNITTEST_EXEC(ut, ServiceTimer timer);
+        CUN_UNITTEST_EXEC(ut, timer = service.create(10ms, [&count, &timer]{ if (++count == 2) (void) timer.stop(); }));
+        CUN_UNITTEST_EVAL(ut, timer.start());
+        CUN_UNITTEST_EXEC(ut, sleep_for(100ms));
+        CUN_UNITTEST_EVAL(ut, count == 2);
+    }
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "overrun policy");
+    {
+        // The first action (at 50ms) overruns the ticks at 100ms and 150ms.
+        CUN_UNITTEST_EXEC(ut, std::atomic_uint count { 0 });
+        CUN_UNITTEST_EXEC(ut, std::atomic<milliseconds::rep> t1 { 0 });
+        CUN_UNITTEST_EXEC(ut, std::atomic<milliseconds::rep> t2 { 0 });
+        CUN_UNITTEST_EXEC(ut, auto timer = service.create(50ms, [&count, &t1, &t2]{
+            const auto n = ++count;
+            if (n == 1) {
+                sleep_for(120ms);
+            } else if (n == 2) {
+                t1 = system_tick::millis();
+            } else if (n == 3) {
+                t2 = system_tick::millis();
+            }
+        }));
+        CUN_UNITTEST_EXEC(ut, timer.set_overrun_policy(OverrunPolicy::skip));
+        CUN_UNITTEST_EXEC(ut, const auto start = system_tick::millis());
+        CUN_UNITTEST_EVAL(ut, timer.start());
+        CUN_UNITTEST_EXEC(ut, while (count < 3) sleep_for(5ms));
+        CUN_UNITTEST_EVAL(ut, timer.stop());
+        CUN_UNITTEST_EVAL(ut, (t1 - start >= 200) && ((t1 - start) % 50 < 20));
+        CUN_UNITTEST_EVAL(ut, (t2 - start >= 250) && ((t2 - start) % 50 < 20));
+        CUN_UNITTEST_EVAL(ut, timer.missed_ticks() >= 2);
+    }
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "slack");
+    {
+        using clock_type = TimerService::clock_type;
+        CUN_UNITTEST_EXEC(ut, std::atomic<clock_type::time_point> t1 {});
+        CUN_UNITTEST_EXEC(ut, std::atomic<clock_type::time_point> t2 {});
+        CUN_UNITTEST_EXEC(ut, auto timer1 = service.create(100ms, 1, [&t1]{ t1 = clock_type::now(); }));
+        CUN_UNITTEST_EXEC(ut, auto timer2 = service.create(101ms, 1, [&t2]{ t2 = clock_type::now(); }));
+        CUN_UNITTEST_EXEC(ut, timer1.set_slack(50ms));
+        CUN_UNITTEST_EXEC(ut, timer2.set_slack(50ms));
+        try {
+            CUN_UNITTEST_EXEC(ut, timer1.set_slack(-1ms));
+            CUN_UNITTEST_EVAL(ut, false);
+        } catch (const std::invalid_argument& e) {
+            CUN_UNITTEST_EVAL(ut, true);
+            CUN_UNITTEST_ECHO(ut, e.what());
+        }
+        try {
+            CUN_UNITTEST_EXEC(ut, timer1.set_slack(100ms));
+            CUN_UNITTEST_EVAL(ut, false);
+        } catch (const std::invalid_argument& e) {
+            CUN_UNITTEST_EVAL(ut, true);
+            CUN_UNITTEST_ECHO(ut, e.what());
+        }
+        CUN_UNITTEST_EXEC(ut, timer1.set_slack(99ms));
+        CUN_UNITTEST_EXEC(ut, timer1.set_slack(50ms));
+        // Start just after a multiple of the slack, so both deadlines are rounded up to the same wake-up.
+        CUN_UNITTEST_EXEC(ut, const auto base = clock_type::time_point { clock_type::now().time_since_epoch() / 50ms * 50ms + 50ms });
+        CUN_UNITTEST_EXEC(ut, std::this_thread::sleep_until(base + 1ms));
+        CUN_UNITTEST_EVAL(ut, timer1.start());
+        CUN_UNITTEST_EVAL(ut, timer2.start());
+        CUN_UNITTEST_EXEC(ut, while (!timer1.expired() || !timer2.expired()) sleep_for(10ms));
+        CUN_UNITTEST_EVAL(ut, t1.load() >= base + 150ms);
+        CUN_UNITTEST_EVAL(ut, t2.load() >= base + 150ms);
+        // Fired in the same slot of the slack, whatever the scheduling jitter is.
+        CUN_UNITTEST_EVAL(ut, (t1.load() - base) / 50ms == (t2.load() - base) / 50ms);
+    }
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "restart from the action with a thread pool");
+    {
+        CUN_UNITTEST_EXEC(ut, TimerService pool { 4 });
+        CUN_UNITTEST_EXEC(ut, std::atomic_uint count { 0 });
+        CUN_UNITTEST_EXEC(ut, std::atomic_int running { 0 });
+        CUN_UNITTEST_EXEC(ut, std::atomic_int max_running { 0 });
+        CUN_UNITTEST_EXEC(ut, ServiceTimer timer);
+        CUN_UNITTEST_EXEC(ut, timer = pool.create(1ms, [&]{
+            const auto n = ++running;
+            if (n > max_running) {
+                max_running = n;
+            }
+            ++count;
+            (void) timer.restart();
+            sleep_for(5ms);
+            --running;
+        }));
+        CUN_UNITTEST_EVAL(ut, timer.start());
+        CUN_UNITTEST_EXEC(ut, while (count < 10) sleep_for(5ms));
+        CUN_UNITTEST_EVAL(ut, timer.stop());
+        CUN_UNITTEST_EVAL(ut, max_running == 1);
+    }
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "many timers with one thread");
+    {
+        static constexpr unsigned NUM_TIMERS { 3000 };
+        CUN_UNITTEST_EXEC(ut, std::atomic_uint num_expired { 0 });
+        CUN_UNITTEST_EXEC(ut, std::vector<ServiceTimer> timers);
+        for (unsigned i = 0; i < NUM_TIMERS; i++) {
+            timers.push_back(service.create(milliseconds { 1 + i % 10 }, 3, [&num_expired, n = 0]() mutable {
+                if (++n == 3) {
+                    ++num_expired;
+                }
+            }));
+            (void) timers.back().start();
+        }
+        CUN_UNITTEST_EXEC(ut, while (num_expired < NUM_TIMERS) sleep_for(10ms));
+        CUN_UNITTEST_EVAL(ut, num_expired == NUM_TIMERS);
+        CUN_UNITTEST_EXEC(ut, timers.clear());
+    }
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "thread pool");
+    {
+        CUN_UNITTEST_EXEC(ut, TimerService pool { 4 });
+        CUN_UNITTEST_EVAL(ut, pool.num_threads() == 4);
+        CUN_UNITTEST_EXEC(ut, std::atomic_uint count { 0 });
+        CUN_UNITTEST_EXEC(ut, auto slow = pool.create(10ms, []{ sleep_for(50ms); }));
+        CUN_UNITTEST_EXEC(ut, auto fast = pool.create(5ms, 10, [&count]{ ++count; }));
+        CUN_UNITTEST_EVAL(ut, slow.start());
+        CUN_UNITTEST_EVAL(ut, fast.start());
+        CUN_UNITTEST_EXEC(ut, while (!fast.expired()) sleep_for(10ms));
+        CUN_UNITTEST_EVAL(ut, count == 10);
+        CUN_UNITTEST_EVAL(ut, slow.stop());
+    }
+    CUN_UNITTEST_NL(ut);
+
+    return EXIT_SUCCESS;
+}
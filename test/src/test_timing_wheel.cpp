@@ -0,0 +1,165 @@
+﻿// -*- coding: utf-8-with-signature-dos -*-
+// vim:fileencoding=utf-8:ff=dos
+//
+// Test code: A hashed hierarchical timing wheel.
+
+// C++ standard library
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+#include <vector>
+
+// C++ user library
+#include "timing_wheel.hpp"
+#include "unittest.hpp"
+
+int main()
+{
+    // C++ standard library
+    using namespace std::literals::chrono_literals;
+    using std::uint64_t;
+
+    // C++ user library
+    using cun::TimingWheel;
+
+    using Wheel = TimingWheel<int>;
+    using SmallWheel = TimingWheel<int, 2, 2>;
+
+    auto ut = CUN_UNITTEST_MAKE();
+
+    CUN_UNITTEST_TITLE(ut, "Test code: A hashed hierarchical timing wheel.");
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "constructor parameter check");
+    try {
+        CUN_UNITTEST_EXEC(ut, Wheel wheel { 0ms });
+        CUN_UNITTEST_EVAL(ut, false);
+    } catch (const std::invalid_argument& e) {
+        CUN_UNITTEST_EVAL(ut, true);
+        CUN_UNITTEST_ECHO(ut, e.what());
+    }
+    CUN_UNITTEST_EXEC(ut, const auto t0 = Wheel::clock_type::now());
+    CUN_UNITTEST_EXEC(ut, Wheel wheel { 1ms, t0 });
+    CUN_UNITTEST_EVAL(ut, wheel.tick() == 1ms);
+    CUN_UNITTEST_EVAL(ut, wheel.current_tick() == 0);
+    CUN_UNITTEST_EVAL(ut, wheel.empty());
+    CUN_UNITTEST_EVAL(ut, Wheel::MAX_DELAY == (uint64_t { 1 } << 24) - 1);
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "expire at the exact tick");
+    {
+        CUN_UNITTEST_EXEC(ut, std::vector<uint64_t> delays { 0, 1, 2, 63, 64, 65, 4095, 4096, 4097, 300000 });
+        CUN_UNITTEST_EXEC(ut, std::vector<uint64_t> fired(delays.size()));
+        for (std::size_t i = 0; i < delays.size(); i++) {
+            (void) wheel.schedule(delays[i], static_cast<int>(i));
+        }
+        CUN_UNITTEST_EVAL(ut, wheel.size() == delays.size());
+        CUN_UNITTEST_EXEC(ut, const auto base = wheel.current_tick());
+        CUN_UNITTEST_EXEC(ut, std::size_t n = 0);
+        while (!wheel.empty()) {
+            n += wheel.advance(1, [&](int& i){ fired[i] = wheel.current_tick() - base; });
+        }
+        CUN_UNITTEST_EVAL(ut, n == delays.size());
+        CUN_UNITTEST_EVAL(ut, fired[0] == 1);
+        CUN_UNITTEST_EXEC(ut, bool ok = true);
+        for (std::size_t i = 1; i < delays.size(); i++) {
+            ok = ok && (fired[i] == delays[i]);
+        }
+        CUN_UNITTEST_EVAL(ut, ok);
+    }
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "beyond the maximum delay");
+    {
+        CUN_UNITTEST_EXEC(ut, SmallWheel small { 1ms });
+        CUN_UNITTEST_EVAL(ut, SmallWheel::MAX_DELAY == 15);
+        CUN_UNITTEST_EXEC(ut, uint64_t fired = 0);
+        CUN_UNITTEST_EXEC(ut, (void) small.schedule(100, 1));
+        CUN_UNITTEST_EVAL(ut, small.advance(99, [&](int&){ fired = small.current_tick(); }) == 0);
+        CUN_UNITTEST_EVAL(ut, small.advance(1, [&](int&){ fired = small.current_tick(); }) == 1);
+        CUN_UNITTEST_EVAL(ut, fired == 100);
+    }
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "cancel");
+    {
+        CUN_UNITTEST_EXEC(ut, int fired = 0);
+        CUN_UNITTEST_EXEC(ut, const auto id1 = wheel.schedule(10, 1));
+        CUN_UNITTEST_EXEC(ut, const auto id2 = wheel.schedule(100, 2));
+        CUN_UNITTEST_EVAL(ut, id1 != 0 && id2 != 0 && id1 != id2);
+        CUN_UNITTEST_EVAL(ut, wheel.cancel(id2));
+        CUN_UNITTEST_EVAL(ut, !wheel.cancel(id2));
+        CUN_UNITTEST_EVAL(ut, wheel.size() == 1);
+        CUN_UNITTEST_EVAL(ut, wheel.advance(200, [&](int& i){ fired += i; }) == 1);
+        CUN_UNITTEST_EVAL(ut, fired == 1);
+        CUN_UNITTEST_EVAL(ut, !wheel.cancel(id1));
+        CUN_UNITTEST_EXEC(ut, const auto id3 = wheel.schedule(10, 3));
+        CUN_UNITTEST_EVAL(ut, !wheel.cancel(id1) && !wheel.cancel(id2));
+        CUN_UNITTEST_EVAL(ut, wheel.cancel(id3));
+        CUN_UNITTEST_EVAL(ut, !wheel.cancel(0));
+        CUN_UNITTEST_EVAL(ut, wheel.empty());
+    }
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "batched expiry with many timers");
+    {
+        static constexpr int NUM_TIMERS { 100000 };
+        CUN_UNITTEST_EXEC(ut, std::vector<Wheel::timer_id> ids);
+        CUN_UNITTEST_EXEC(ut, std::vector<uint64_t> expiries);
+        for (int i = 0; i < NUM_TIMERS; i++) {
+            const auto delay = (static_cast<uint64_t>(i) * 7919) % 20000;
+            ids.push_back(wheel.schedule(delay, i));
+            expiries.push_back(wheel.current_tick() + ((delay != 0) ? delay : 1));
+        }
+        for (int i = 0; i < NUM_TIMERS; i += 2) {
+            (void) wheel.cancel(ids[i]);
+        }
+        CUN_UNITTEST_EVAL(ut, wheel.size() == NUM_TIMERS / 2);
+        CUN_UNITTEST_EXEC(ut, bool ok = true);
+        CUN_UNITTEST_EXEC(ut, std::size_t n = 0);
+        while (!wheel.empty()) {
+            n += wheel.advance(100, [&](int& i){
+                ok = ok && (i % 2 == 1) && (expiries[i] <= wheel.current_tick());
+                ok = ok && (wheel.current_tick() < expiries[i] + 1);
+            });
+        }
+        CUN_UNITTEST_EVAL(ut, n == NUM_TIMERS / 2);
+        CUN_UNITTEST_EVAL(ut, ok);
+    }
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "schedule from the function");
+    {
+        CUN_UNITTEST_EXEC(ut, int count = 0);
+        CUN_UNITTEST_EXEC(ut, (void) wheel.schedule(5, 0));
+        CUN_UNITTEST_EXEC(ut, auto rearm = [&](int&){ if (++count < 3) (void) wheel.schedule(0, 0); });
+        CUN_UNITTEST_EVAL(ut, wheel.advance(5, rearm) == 1);
+        CUN_UNITTEST_EVAL(ut, wheel.advance(1, rearm) == 1);
+        CUN_UNITTEST_EVAL(ut, wheel.advance(1, rearm) == 1);
+        CUN_UNITTEST_EVAL(ut, count == 3);
+        CUN_UNITTEST_EVAL(ut, wheel.empty());
+    }
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "time based interface");
+    {
+        CUN_UNITTEST_EXEC(ut, Wheel tw { 1ms, t0 });
+        CUN_UNITTEST_EXEC(ut, int fired = 0);
+        CUN_UNITTEST_EXEC(ut, (void) tw.schedule_at(t0 + 2500us, 1));
+        CUN_UNITTEST_EXEC(ut, (void) tw.schedule_at(t0 - 1ms, 2));
+        CUN_UNITTEST_EVAL(ut, tw.advance_to(t0 + 999us, [&](int& i){ fired += i; }) == 0);
+        CUN_UNITTEST_EVAL(ut, tw.advance_to(t0 + 1ms, [&](int& i){ fired += i; }) == 1);
+        CUN_UNITTEST_EVAL(ut, fired == 2);
+        CUN_UNITTEST_EVAL(ut, tw.advance_to(t0 + 2ms, [&](int& i){ fired += i; }) == 0);
+        CUN_UNITTEST_EVAL(ut, tw.advance_to(t0 + 3ms, [&](int& i){ fired += i; }) == 1);
+        CUN_UNITTEST_EVAL(ut, fired == 3);
+        CUN_UNITTEST_EVAL(ut, tw.current_tick() == 3);
+        CUN_UNITTEST_EXEC(ut, (void) tw.schedule_after(10ms, 4));
+        CUN_UNITTEST_EVAL(ut, tw.advance_to(Wheel::clock_type::now() + 20ms, [&](int& i){ fired += i; }) == 1);
+        CUN_UNITTEST_EVAL(ut, fired == 7);
+    }
+    CUN_UNITTEST_NL(ut);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,162 @@
+﻿// -*- coding: utf-8-with-signature-dos -*-
+// vim:fileencoding=utf-8:ff=dos
+//
+// Test code: Typed event loop toolbox.
+
+// C++ standard library
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <utility>
+
+// C++ user library
+#include "typed_event_loop.hpp"
+#include "unittest.hpp"
+
+namespace {
+
+std::atomic_size_t num_allocations { 0 };
+
+} // namespace
+
+void *operator new(std::size_t size)
+{
+    num_allocations++;
+    if (auto *p = std::malloc((size != 0) ? size : 1); p != nullptr) {
+        return p;
+    }
+    throw std::bad_alloc {};
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+namespace {
+
+// C++ standard library
+using std::make_pair;
+using std::int32_t;
+
+// C++ user library
+using cun::TypedEventLoop;
+using cun::UnitTest;
+
+enum class EventType {
+    on_add,
+    on_get,
+    on_unknown
+};
+
+struct Point final {
+    int32_t x;
+    int32_t y;
+};
+
+struct Context final {
+    std::atomic<int32_t> sum { 0 };
+};
+
+using Loop = TypedEventLoop<EventType, Context *>;
+
+bool on_add(Context *ctx, Loop::args_type& args, Loop::args_type&)
+{
+    if (const auto *pt = args.get_if<Point>(); pt != nullptr) {
+        ctx->sum += pt->x + pt->y;
+        return true;
+    }
+    if (const auto *n = args.get_if<int32_t>(); n != nullptr) {
+        ctx->sum += *n;
+        return true;
+    }
+    return false;
+}
+
+bool on_get(Context *ctx, Loop::args_type&, Loop::args_type& results)
+{
+    auto **out = results.get_if<int32_t *>();
+    if (out == nullptr) {
+        return false;
+    }
+    **out = ctx->sum;
+    return true;
+}
+
+} // namespace
+
+int main()
+{
+    auto ut = CUN_UNITTEST_MAKE();
+
+    CUN_UNITTEST_TITLE(ut, "Test code: Typed event loop toolbox.");
+    CUN_UNITTEST_NL(ut);
+
+    Loop::event_entry entry {
+        make_pair(EventType::on_add, on_add),
+        make_pair(EventType::on_get, on_get),
+    };
+
+    CUN_UNITTEST_EXEC(ut, Context context);
+    {
+        CUN_UNITTEST_EXEC(ut, Loop el(entry, &context));
+        CUN_UNITTEST_EXEC(ut, int32_t result = 0);
+        CUN_UNITTEST_NL(ut);
+
+        CUN_UNITTEST_NAME(ut, "send and post events");
+        CUN_UNITTEST_EVAL(ut, el.post_event(EventType::on_add, int32_t { 1 }));
+        CUN_UNITTEST_EVAL(ut, el.send_event(EventType::on_add, Point { 2, 3 }));
+        CUN_UNITTEST_EVAL(ut, !el.send_event(EventType::on_add));
+        CUN_UNITTEST_EVAL(ut, !el.send_event(EventType::on_unknown));
+        CUN_UNITTEST_EVAL(ut, el.send_event(EventType::on_get, nullptr, &result));
+        CUN_UNITTEST_EVAL(ut, result == 6);
+        CUN_UNITTEST_NL(ut);
+
+        CUN_UNITTEST_NAME(ut, "post events without dynamic memory allocation");
+        CUN_UNITTEST_EXEC(ut, const auto n = num_allocations.load());
+        for (int32_t i = 0; i < 10000; i++) {
+            (void) el.post_event(EventType::on_add, Point { i, 1 });
+        }
+        CUN_UNITTEST_EVAL(ut, num_allocations == n);
+        CUN_UNITTEST_NL(ut);
+
+        CUN_UNITTEST_NAME(ut, "send events without dynamic memory allocation");
+        CUN_UNITTEST_EXEC(ut, const auto m = num_allocations.load());
+        CUN_UNITTEST_EXEC(ut, bool ok = true);
+        for (int32_t i = 0; i < 1000; i++) {
+            ok = el.send_event(EventType::on_add, int32_t { 0 }) && ok;
+        }
+        CUN_UNITTEST_EVAL(ut, ok);
+        CUN_UNITTEST_EVAL(ut, num_allocations == m);
+    }
+    CUN_UNITTEST_EVAL(ut, context.sum == 6 + 10000 * 9999 / 2 + 10000);
+    CUN_UNITTEST_NL(ut);
+
+    CUN_UNITTEST_NAME(ut, "dense dispatch table");
+    {
+        using DenseLoop = TypedEventLoop<EventType, Context *, cun::ReturnTraits<bool>, 32, 256, cun::EnumTableOf<2>::type>;
+
+        static constexpr DenseLoop::event_entry DENSE_ENTRY {
+            make_pair(EventType::on_add, on_add),
+            make_pair(EventType::on_get, on_get),
+        };
+
+        CUN_UNITTEST_EXEC(ut, Context context2);
+        CUN_UNITTEST_EXEC(ut, DenseLoop el(DENSE_ENTRY, &context2));
+        CUN_UNITTEST_EXEC(ut, int32_t result = 0);
+        CUN_UNITTEST_EVAL(ut, el.post_event(EventType::on_add, int32_t { 4 }));
+        CUN_UNITTEST_EVAL(ut, !el.send_event(EventType::on_unknown));
+        CUN_UNITTEST_EVAL(ut, el.send_event(EventType::on_get, nullptr, &result));
+        CUN_UNITTEST_EVAL(ut, result == 4);
+    }
+    CUN_UNITTEST_NL(ut);
+
+    return EXIT_SUCCESS;
+}